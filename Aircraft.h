@@ -14,16 +14,19 @@ private:
 	int cost;
 	int capacity;
 	int numAircrafts;
+	// minimum turn time in minutes
+	int turnTime;
 
 public:
 	std::vector<Flight*> scheduledFlights;
 
-	Aircraft(std::string tn, int c, int cap, int num):
+	Aircraft(std::string tn, int c, int cap, int num, int turn = 0):
 		tailNumber(tn),
 		acID(std::hash<std::string>{}(tn)),
 		cost(c),
 		capacity(cap),
-		numAircrafts(num)
+		numAircrafts(num),
+		turnTime(turn)
 	{}
 
 	void addScheduledFlight(Flight* leg) { scheduledFlights.push_back(leg); }
@@ -39,4 +42,5 @@ public:
 
 	int getCost() const { return cost; }
 	int getCapacity() const { return capacity; }
+	int getTurnTime() const { return turnTime; }
 };
\ No newline at end of file
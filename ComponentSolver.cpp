@@ -0,0 +1,274 @@
+#include "ComponentSolver.h"
+#include "DataManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+namespace {
+    int findRoot(std::vector<int>& parent, int x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void unite(std::vector<int>& parent, int a, int b)
+    {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a != b)
+            parent[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+ComponentSolver::ComponentSolver(const std::string& inputDirectory, const std::string& outputDirectory) :
+    input_directory(inputDirectory),
+    output_directory(outputDirectory),
+    objective(0),
+    lagrangianBound(0),
+    numRounds(0),
+    cpuTime(0)
+{}
+
+template <class Task>
+bool ComponentSolver::forEachComponent(Task task)
+{
+    const int numComponents = static_cast<int>(components.size());
+    const int numThreads = std::min(numComponents, std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        for (int c = next++; c < numComponents; c = next++)
+        {
+            try
+            {
+                task(c);
+            }
+            catch (const IloException& e)
+            {
+                cerr << "Component " << c << ": exception caught: " << e << endl;
+                failed = true;
+            }
+            catch (const std::exception& e)
+            {
+                cerr << "Component " << c << ": " << e.what() << endl;
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+    return !failed;
+}
+
+int ComponentSolver::analyze()
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& schLegs = dataReg->schLegs;
+    const auto& products = dataReg->products;
+
+    // union-find over station IDs (1-based): legs join their end points, products their origin,
+    // destination and the stations of their legs
+    std::vector<int> parent(dataReg->stations.size() + 1);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const auto& leg : schLegs)
+        unite(parent, leg->getDepStation()->getID(), leg->getArrStation()->getID());
+    for (int p = 0; p < static_cast<int>(products.size()); p++)
+    {
+        const int ori = products[p]->getOrigin()->getID();
+        unite(parent, ori, products[p]->getDestination()->getID());
+        for (int i = dataReg->productLegStart[p]; i < dataReg->productLegStart[p + 1]; i++)
+            unite(parent, ori, schLegs[dataReg->productLegs[i]]->getDepStation()->getID());
+    }
+
+    // components in order of their first leg
+    components.clear();
+    std::vector<int> componentOf(parent.size(), -1);
+    for (int l = 0; l < static_cast<int>(schLegs.size()); l++)
+    {
+        int& c = componentOf[findRoot(parent, schLegs[l]->getDepStation()->getID())];
+        if (c < 0)
+        {
+            c = static_cast<int>(components.size());
+            components.push_back(Component{ {}, {}, 0 });
+        }
+        components[c].legs.push_back(l);
+    }
+    if (components.empty())
+        return 0;
+
+    // products between stations without legs cannot fly and go with the first component
+    for (int p = 0; p < static_cast<int>(products.size()); p++)
+    {
+        const int c = componentOf[findRoot(parent, products[p]->getOrigin()->getID())];
+        components[c < 0 ? 0 : c].products.push_back(p);
+    }
+    for (int s = 1; s < static_cast<int>(parent.size()); s++)
+    {
+        const int c = componentOf[findRoot(parent, s)];
+        if (c >= 0)
+            components[c].numStations++;
+    }
+
+    if (ParamRegistry::instance()->printAlgProcess)
+    {
+        cout << "Components: " << components.size() << endl;
+        for (size_t c = 0; c < components.size(); c++)
+            cout << "  " << c << ": " << components[c].legs.size() << " legs, " << components[c].products.size()
+                << " products, " << components[c].numStations << " stations" << endl;
+    }
+    return static_cast<int>(components.size());
+}
+
+/* Every round solves all components with the current fleet prices. A round whose aircraft at the
+ * count line fit the fleets is a feasible merged solution, its objective is the components'
+ * objectives without the prices. The components' MIP bounds on their priced objectives plus
+ * price * fleet size bound the optimum from above; their incumbents would not. */
+bool ComponentSolver::solve()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    const int numAircraft = static_cast<int>(aircrafts.size());
+    const int numComponents = static_cast<int>(components.size());
+    const int hwThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const auto start = std::chrono::steady_clock::now();
+
+    models.clear();
+    for (int c = 0; c < numComponents; c++)
+    {
+        models.emplace_back(new TS_Model(input_directory));
+        models[c]->setOutputDirectory(output_directory + "c" + std::to_string(c) + "_");
+        models[c]->setScope(components[c].legs, components[c].products);
+    }
+
+    // each model has its own environment, so they build and solve side by side
+    const int cplexThreads = std::max(1, hwThreads / numComponents);
+    if (!forEachComponent([this, cplexThreads](int c) {
+        models[c]->buildModel();
+        models[c]->addFleetUsage();
+        models[c]->getCplex().setParam(IloCplex::Param::Threads, cplexThreads);
+        }))
+        return false;
+
+    double step = paramReg->coordinationStep;
+    if (step <= 0)
+        for (const auto& ac : aircrafts)
+            step = std::max(step, static_cast<double>(ac->getCost()));
+
+    std::vector<double> price(numAircraft, 0.0);
+    std::vector<double> componentObj(numComponents);
+    std::vector<double> componentBound(numComponents);
+    std::vector<std::vector<double> > componentUsage(numComponents, std::vector<double>(numAircraft));
+    bool found = false;
+    objective = -IloInfinity;
+    lagrangianBound = IloInfinity;
+
+    for (numRounds = 1; numRounds <= paramReg->maxCoordinationRounds; numRounds++)
+    {
+        std::vector<char> solved(numComponents, 0);
+        const bool ok = forEachComponent([&](int c) {
+            for (int k = 0; k < numAircraft; k++)
+                models[c]->setFleetPrice(k, price[k]);
+            models[c]->solve();
+            if (!models[c]->hasSolution())
+                return;
+            solved[c] = 1;
+            componentObj[c] = models[c]->getCplex().getObjValue();
+            componentBound[c] = models[c]->getCplex().getBestObjValue();
+            for (int k = 0; k < numAircraft; k++)
+                componentUsage[c][k] = models[c]->getFleetUsage(k);
+            });
+        if (!ok || std::find(solved.begin(), solved.end(), 0) != solved.end())
+        {
+            cerr << "A component has no solution, the decomposition stops" << endl;
+            break;
+        }
+
+        std::vector<double> usage(numAircraft, 0.0);
+        double priced = 0;
+        double trueObj = 0;
+        for (int c = 0; c < numComponents; c++)
+        {
+            priced += componentBound[c];
+            trueObj += componentObj[c];
+            for (int k = 0; k < numAircraft; k++)
+            {
+                usage[k] += componentUsage[c][k];
+                trueObj += price[k] * componentUsage[c][k];
+            }
+        }
+        bool feasible = true;
+        double bound = priced;
+        for (int k = 0; k < numAircraft; k++)
+        {
+            bound += price[k] * aircrafts[k]->getNumAircrafts();
+            if (usage[k] > aircrafts[k]->getNumAircrafts() + 1.0e-6)
+                feasible = false;
+        }
+        lagrangianBound = std::min(lagrangianBound, bound);
+
+        if (feasible && trueObj > objective)
+        {
+            found = true;
+            objective = trueObj;
+            fleetUsage = usage;
+            assignment.clear();
+            retimedDepartures.clear();
+            for (const auto& model : models)
+            {
+                assignment.insert(model->getAssignment().begin(), model->getAssignment().end());
+                retimedDepartures.insert(model->getRetimedDepartures().begin(), model->getRetimedDepartures().end());
+            }
+        }
+
+        if (paramReg->printAlgProcess)
+            cout << "Coordination round " << numRounds << ": objective " << trueObj << (feasible ? "" : " (over fleet)")
+                << ", bound " << lagrangianBound << endl;
+        if (found && lagrangianBound - objective <= paramReg->mpGapTol * std::fabs(objective))
+            break;
+
+        // subgradient step on the fleets' excess aircraft
+        for (int k = 0; k < numAircraft; k++)
+            price[k] = std::max(0.0, price[k] + step / numRounds * (usage[k] - aircrafts[k]->getNumAircrafts()));
+    }
+    numRounds = std::min(numRounds, paramReg->maxCoordinationRounds);
+    cpuTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return found;
+}
+
+void ComponentSolver::writeResults(const std::string& filename) const
+{
+    std::ofstream output;
+    output.open(filename.c_str());
+
+    output << "Objective:\t" << objective << std::endl;
+    output << "Total CPU time:\t" << cpuTime << std::endl;
+    output << "Components:\t" << components.size() << std::endl;
+    output << "Coordination rounds:\t" << numRounds << std::endl;
+    output << "Lagrangian bound:\t" << lagrangianBound << std::endl;
+    output << "================== Aircraft Assignment ==================" << std::endl;
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    const auto& legs = DataRegistry::instance()->schLegs;
+    for (auto& it : assignment)
+    {
+        output << legs[it.first]->getFlightNum() << "\t";
+        output << aircrafts[it.second]->getTail();
+        auto itRetimed = retimedDepartures.find(it.first);
+        if (itRetimed != retimedDepartures.end())
+            output << "\t" << itRetimed->second;
+        output << std::endl;
+    }
+
+    output.close();
+}
@@ -0,0 +1,54 @@
+#ifndef COMPONENT_SOLVER_H
+#define COMPONENT_SOLVER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TS_Model.h"
+
+/* Splits the schedule into station clusters that share no legs and no products and solves one
+ * TS_Model per cluster, in parallel. Every fleet may fly every leg, so the clusters are linked only
+ * through the FleetNum rows: each cluster model keeps them with the full fleet sizes, and a
+ * Lagrangian price per fleet on the aircraft at the count line is adjusted by subgradient steps
+ * until the merged solution fits the fleets. */
+class ComponentSolver {
+public:
+	ComponentSolver(const std::string& inputDirectory, const std::string& outputDirectory);
+
+	// finds the components, returns how many there are
+	int analyze();
+	// false if no merged solution within the fleet sizes was found
+	bool solve();
+	void writeResults(const std::string& filename) const;
+
+	const std::map<unsigned, unsigned>& getAssignment() const { return assignment; }
+	const std::map<unsigned, std::string>& getRetimedDepartures() const { return retimedDepartures; }
+
+private:
+	struct Component {
+		std::vector<int> legs;
+		std::vector<int> products;
+		int numStations;
+	};
+
+	std::string input_directory;
+	std::string output_directory;
+	std::vector<Component> components;
+	std::vector<std::unique_ptr<TS_Model> > models;
+
+	std::map<unsigned, unsigned> assignment;
+	std::map<unsigned, std::string> retimedDepartures;
+	std::vector<double> fleetUsage;
+	double objective;
+	double lagrangianBound;
+	int numRounds;
+	double cpuTime;
+
+	// runs task(c) for every component on a pool of threads, false if any of them threw
+	template <class Task>
+	bool forEachComponent(Task task);
+};
+
+#endif // !COMPONENT_SOLVER_H
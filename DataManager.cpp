@@ -1,6 +1,9 @@
 #include "DataManager.h"
+#include "ItineraryGenerator.h"
+#include "SsimReader.h"
 #include "boost/algorithm/string.hpp"
 #include <fstream>
+#include <stdexcept>
 
 DataRegistry* DataRegistry::dataInstance = nullptr;
 ParamRegistry* ParamRegistry::paramInstance = nullptr;
@@ -25,15 +28,93 @@ ParamRegistry::ParamRegistry()
     maxIterations = 10;
     scoreThreshold = -0.1;
     maxCopyRatio = 2;
+
+    lazyCapacityRows = false;
+
+    useBenders = false;
+    bendersMaxRounds = 100;
+    bendersGapTol = 1.0e-4;
+    bendersWorkers = 0;
+
+    useRetiming = false;
+    retimeWindow = 30;
+    retimeStep = 10;
+
+    useLpDiving = false;
+    maxDivingTime = 5 * 60;
+    divingIntTol = 1.0e-6;
+    divingBatchSize = 10;
+
+    numDemandSamples = 0;
+    demandCv = 0.3;
+    simSeed = 20240101;
+
+    useSsimSchedule = false;
+    ssimFile = "schedule.ssim";
+    ssimDate = "";
+
+    pipelinedStartup = true;
+
+    logProgress = true;
+    progressInterval = 1.0;
+    progressGapTargets = { 0.10, 0.05, 0.02, 0.01, 0.005 };
+
+    decomposeComponents = false;
+    maxCoordinationRounds = 20;
+    coordinationStep = 0;
+
+    fleetPrecheck = true;
+
+    useLocalSearch = false;
+    maxChainLength = 3;
+    localSearchTime = 30;
+    localSearchMipTime = 10;
+
+    sweepFleets = {};
+    sweepRange = 2;
+    sweepWorkers = 0;
+
+    timeBucket = 1;
+
+    modelCacheDir = "";
+
+    outOfCoreDir = "";
+    outOfCoreRunSize = 1 << 22;
+
+    odDemandFile = "";
+    maxConnections = 2;
+    minConnectionTime = 30;
+    maxConnectionTime = 300;
+    maxItinerariesPerOd = 10;
+    itineraryTimeScale = 60;
+
+    numDelaySamples = 0;
+    delayProbability = 0.3;
+    delayMean = 20;
+    onTimeThreshold = 15;
+
+    autoStrategy = false;
+    strategyHistory = "strategy_runs.csv";
+    strategySafety = 0.8;
+
+    countLine = "2300";
+    fleetCountStep = 0;
+
+    solverGuidance = false;
+    guidanceHubShare = 0.1;
 }
 
 void DataRegistry::readInputDataFile(const std::string& input_directory)
 {
-    auto cg_dataReg = DataRegistry::instance();
+    readAircraftFile(input_directory + "ac.csv");
+    readScheduleInput(input_directory);
+    readProductInput(input_directory);
+    buildIncidence();
+}
 
-    std::string schFile = input_directory + "schedule.csv";
-    std::string acFile = input_directory + "ac.csv";
-    std::string pdFile = input_directory + "product.csv";
+void DataRegistry::readAircraftFile(const std::string& acFile)
+{
+    auto cg_dataReg = DataRegistry::instance();
 
     std::ifstream ifsAc;
     ifsAc.open(acFile, std::ifstream::in);
@@ -58,6 +139,7 @@ void DataRegistry::readInputDataFile(const std::string& input_directory)
         int i = 0;
         std::string tail;
         int capcity, cost, num;
+        int turn = 0;
         for (auto const& sVal : sVals)
         {
             switch (i)
@@ -74,25 +156,62 @@ void DataRegistry::readInputDataFile(const std::string& input_directory)
             case 3:
                 num = std::stoi(sVal);
                 break;
+            case 4:
+                turn = std::stoi(sVal);
+                break;
             default:
                 break;
             }
             ++i;
         }
-        auto pAc = std::make_shared<Aircraft>(tail, cost, capcity, num);
+        auto pAc = cg_dataReg->aircraftArena.create(tail, cost, capcity, num, turn);
         cg_dataReg->aircrafts.push_back(pAc);
+        cg_dataReg->_taiMap[tail] = pAc;
         pAc->setID(cg_dataReg->aircrafts.size());
     }
     ifsAc.close();
+}
 
+void DataRegistry::readScheduleInput(const std::string& input_directory)
+{
+    const auto paramReg = ParamRegistry::instance();
+    if (paramReg->useSsimSchedule)
+    {
+        SsimReader reader;
+        reader.read(input_directory + paramReg->ssimFile, paramReg->ssimDate);
+    }
+    else
+    {
+        readScheduleFile(input_directory + "schedule.csv");
+    }
+}
 
-    std::ifstream ifsSch;
-    ifsSch.open(schFile, std::ifstream::in);
-    first_line = true;
-    while (ifsSch.good())
+// product.csv, and with odDemandFile the itineraries of the O&D demand on top
+void DataRegistry::readProductInput(const std::string& input_directory)
+{
+    const auto paramReg = ParamRegistry::instance();
+    readProductFile(input_directory + "product.csv");
+    if (paramReg->odDemandFile.empty())
+        return;
+    ItineraryGenerator generator(paramReg->maxConnections, paramReg->minConnectionTime, paramReg->maxConnectionTime);
+    generator.readOdFile(input_directory + paramReg->odDemandFile);
+    const int created = generator.generate(paramReg->maxItinerariesPerOd, paramReg->itineraryTimeScale, 0);
+    if (paramReg->printAlgProcess)
+        std::cout << "Itineraries: " << created << " products from " << paramReg->odDemandFile << std::endl;
+}
+
+void DataRegistry::readProductFile(const std::string& pdFile)
+{
+    auto cg_dataReg = DataRegistry::instance();
+
+    std::ifstream ifsPd;
+    ifsPd.open(pdFile, std::ifstream::in);
+    bool first_line = true;
+    while (ifsPd.good())
     {
+
         char lineChars[256];
-        ifsSch.getline(lineChars, 256);
+        ifsPd.getline(lineChars, 256);
         if (first_line) {
             first_line = false;
             continue;
@@ -105,57 +224,63 @@ void DataRegistry::readInputDataFile(const std::string& input_directory)
         {
             break;
         }
-
-        int lID, dur;
-        std::string fltNum, depTime, arrTime, depSta, arrSta;
         int i = 0;
+        std::string ori, des;
+        std::vector<std::string> flts;
+        double f, d;
         for (auto const& sVal : sVals)
         {
             switch (i)
             {
             case 0:
-                fltNum = sVal;
+                ori = sVal;
                 break;
             case 1:
-                depTime = sVal;
+                des = sVal;
                 break;
             case 2:
-                arrTime = sVal;
+                f = std::stod(sVal);
                 break;
             case 3:
-                depSta = sVal;
-                break;
-            case 4:
-                arrSta = sVal;
-                break;
-            case 5:
-                dur = std::stoi(sVal);
-                break;
-            case 6:
-                lID = std::stoi(sVal);
+                d = std::stod(sVal);
                 break;
             default:
+                flts.push_back(sVal);
                 break;
             }
             ++i;
         }
-        auto pDepStn = getOrCreateStation(depSta);
-        auto pArrStn = getOrCreateStation(arrSta);
-
-        auto pLeg = std::make_shared<Leg>(fltNum, depTime, arrTime, pDepStn, pArrStn, dur, lID);
         
-        cg_dataReg->schLegs.push_back(pLeg);
+        auto pOri = getOrCreateStation(ori);
+        auto pDes = getOrCreateStation(des);
+        auto pPro = cg_dataReg->productArena.create(pOri, pDes, f, d);
+        
+        for (const auto& f : flts)
+            if (f != ".")
+                pPro->addFlt(fltNumbers.intern(f));
+        cg_dataReg->products.push_back(pPro);
+        pPro->setID(cg_dataReg->products.size());
     }
-    ifsSch.close();
+    ifsPd.close();
 
-    std::ifstream ifsPd;
-    ifsPd.open(pdFile, std::ifstream::in);
-    first_line = true;
-    while (ifsPd.good())
-    {
+    /*for(auto &ac : aircrafts){
+       std::sort(ac->scheduledFlights.begin(), ac->scheduledFlights.end(), [](Flight* a, Flight* b)->bool{
+          return a->getDepTime() < b->getDepTime();
+       });
+    }*/
 
+    
+}
+
+void DataRegistry::readScheduleFile(const std::string& schFile)
+{
+    std::ifstream ifsSch;
+    ifsSch.open(schFile, std::ifstream::in);
+    bool first_line = true;
+    while (ifsSch.good())
+    {
         char lineChars[256];
-        ifsPd.getline(lineChars, 256);
+        ifsSch.getline(lineChars, 256);
         if (first_line) {
             first_line = false;
             continue;
@@ -168,52 +293,46 @@ void DataRegistry::readInputDataFile(const std::string& input_directory)
         {
             break;
         }
+
+        int lID, dur;
+        std::string fltNum, depTime, arrTime, depSta, arrSta;
         int i = 0;
-        std::string ori, des;
-        std::vector<std::string> flts;
-        double f, d;
         for (auto const& sVal : sVals)
         {
             switch (i)
             {
             case 0:
-                ori = sVal;
+                fltNum = sVal;
                 break;
             case 1:
-                des = sVal;
+                depTime = sVal;
                 break;
             case 2:
-                f = std::stod(sVal);
+                arrTime = sVal;
                 break;
             case 3:
-                d = std::stod(sVal);
+                depSta = sVal;
+                break;
+            case 4:
+                arrSta = sVal;
+                break;
+            case 5:
+                dur = std::stoi(sVal);
+                break;
+            case 6:
+                lID = std::stoi(sVal);
                 break;
             default:
-                flts.push_back(sVal);
                 break;
             }
             ++i;
         }
-        
-        auto pOri = getOrCreateStation(ori);
-        auto pDes = getOrCreateStation(des);
-        auto pPro = std::make_shared<Product>(pOri, pDes, f, d);
-        
-        for (auto f : flts)
-            if (f != ".")
-                pPro->addFlt(f);
-        cg_dataReg->products.push_back(pPro);
-        pPro->setID(cg_dataReg->products.size());
-    }
-    ifsPd.close();
-
-    /*for(auto &ac : aircrafts){
-       std::sort(ac->scheduledFlights.begin(), ac->scheduledFlights.end(), [](Flight* a, Flight* b)->bool{
-          return a->getDepTime() < b->getDepTime();
-       });
-    }*/
+        auto pDepStn = getOrCreateStation(depSta);
+        auto pArrStn = getOrCreateStation(arrSta);
 
-    
+        createLeg(fltNum, depTime, arrTime, pDepStn, pArrStn, dur, lID);
+    }
+    ifsSch.close();
 }
 
 Station* DataRegistry::getOrCreateStation(const std::string& stnName)
@@ -224,15 +343,77 @@ Station* DataRegistry::getOrCreateStation(const std::string& stnName)
     }
 
     auto reg = DataRegistry::instance();
-    auto itrStn = reg->_stationMap.find(stnName);
-    if (itrStn == reg->_stationMap.end())
+    const int codeID = reg->stationCodes.intern(stnName);
+    if (codeID >= static_cast<int>(reg->_stationMap.size()))
+        reg->_stationMap.resize(codeID + 1, nullptr);
+    if (!reg->_stationMap[codeID])
     {
         int staID = reg->stations.size() + 1;
-        auto pStn = std::make_shared<Station>(stnName, staID);
+        auto pStn = reg->stationArena.create(stnName, staID);
         reg->stations.push_back(pStn);
-        reg->_stationMap[stnName] = pStn;
-        return pStn.get();
+        reg->_stationMap[codeID] = pStn;
+    }
+    return reg->_stationMap[codeID];
+}
+
+Leg* DataRegistry::createLeg(const std::string& fltNum, const std::string& depTime, const std::string& arrTime,
+    Station* depStn, Station* arrStn, int dur, int legID)
+{
+    const int fnID = fltNumbers.intern(fltNum);
+    auto pLeg = legArena.create(fltNumbers.name(fnID), fnID, depTime, arrTime, depStn, arrStn, dur, legID);
+    pLeg->setIndex(static_cast<int>(schLegs.size()));
+    _legIndexMap[legID] = pLeg->getIndex();
+    schLegs.push_back(pLeg);
+    depStn->addDepLeg(pLeg);
+    arrStn->addArrLeg(pLeg);
+    return pLeg;
+}
+
+void DataRegistry::buildIncidence()
+{
+    const int numLegs = static_cast<int>(schLegs.size());
+    const int numProducts = static_cast<int>(products.size());
+
+    // legs flown under each flight number
+    std::vector<std::vector<int> > fltNumLegs(fltNumbers.size());
+    for (int l = 0; l < numLegs; l++)
+        fltNumLegs[schLegs[l]->getFltNumID()].push_back(l);
+
+    productLegStart.assign(1, 0);
+    productLegs.clear();
+    std::vector<int> legCount(numLegs, 0);
+    for (int p = 0; p < numProducts; p++)
+    {
+        for (int l : products[p]->getLegIndices())
+        {
+            productLegs.push_back(l);
+            legCount[l]++;
+        }
+        for (int fnID : products[p]->getFltNumIDs())
+            for (int l : fltNumLegs[fnID])
+            {
+                productLegs.push_back(l);
+                legCount[l]++;
+            }
+        productLegStart.push_back(static_cast<int>(productLegs.size()));
     }
-    return itrStn->second.get();
+
+    // transpose into leg -> products
+    legProductStart.assign(numLegs + 1, 0);
+    for (int l = 0; l < numLegs; l++)
+        legProductStart[l + 1] = legProductStart[l] + legCount[l];
+    legProducts.assign(productLegs.size(), 0);
+    std::vector<int> pos(legProductStart.begin(), legProductStart.end() - 1);
+    for (int p = 0; p < numProducts; p++)
+        for (int i = productLegStart[p]; i < productLegStart[p + 1]; i++)
+            legProducts[pos[productLegs[i]]++] = p;
+}
+
+int DataRegistry::getLegIndex(int legID) const
+{
+    auto it = _legIndexMap.find(legID);
+    if (it == _legIndexMap.end())
+        throw std::out_of_range("unknown leg ID " + std::to_string(legID));
+    return it->second;
 }
 
@@ -5,6 +5,8 @@
 #include "Aircraft.h"
 #include "Station.h"
 #include "Product.h"
+#include "ObjectArena.h"
+#include "StringInterner.h"
 
 #include <unordered_map>
 
@@ -26,16 +28,43 @@ public:
 		return dataInstance;
 	}
 
-	std::vector<std::shared_ptr<Leg> > schLegs;
-	std::vector<std::shared_ptr<Aircraft> > aircrafts;
-	std::vector<std::shared_ptr<Station> > stations;
-	std::vector<std::shared_ptr<Product> > products;
+	ObjectArena<Leg> legArena;
+	ObjectArena<Aircraft> aircraftArena;
+	ObjectArena<Station> stationArena;
+	ObjectArena<Product> productArena;
 
-	std::unordered_map<std::string, std::shared_ptr<Station> > _stationMap;
-	std::unordered_map<std::string, std::shared_ptr<Aircraft> > _taiMap;
+	std::vector<Leg* > schLegs;
+	std::vector<Aircraft* > aircrafts;
+	std::vector<Station* > stations;
+	std::vector<Product* > products;
 
+	StringInterner stationCodes;
+	StringInterner fltNumbers;
+
+	// indexed by station code ID
+	std::vector<Station* > _stationMap;
+	std::unordered_map<std::string, Aircraft* > _taiMap;
+	// leg ID -> index in schLegs
+	std::unordered_map<int, int> _legIndexMap;
+
+	// leg <-> product incidence in CSR form, products are indexed by position in `products`
+	std::vector<int> legProductStart;
+	std::vector<int> legProducts;
+	std::vector<int> productLegStart;
+	std::vector<int> productLegs;
+
+	// reads all inputs in sequence; TS_Model::prepare reads them stage by stage
 	void readInputDataFile(const std::string& input_directory);
+	void readAircraftFile(const std::string& acFile);
+	void readScheduleInput(const std::string& input_directory);
+	void readScheduleFile(const std::string& schFile);
+	void readProductInput(const std::string& input_directory);
+	void readProductFile(const std::string& pdFile);
 	Station* getOrCreateStation(const std::string& stnName);
+	Leg* createLeg(const std::string& fltNum, const std::string& depTime, const std::string& arrTime,
+		Station* depStn, Station* arrStn, int dur, int legID);
+	void buildIncidence();
+	int getLegIndex(int legID) const;
 };
 
 class ParamRegistry {
@@ -64,6 +93,104 @@ public:
 	int maxIterations;
 	double scoreThreshold;
 	double maxCopyRatio;
+
+	bool lazyCapacityRows;
+
+	// fleet flows in the master, passengers in LP subproblems per product component that return
+	// optimality cuts, see TS_Model::solveBenders; 0 workers takes the hardware threads
+	bool useBenders;
+	int bendersMaxRounds;
+	double bendersGapTol;
+	int bendersWorkers;
+
+	bool useRetiming;
+	int retimeWindow;
+	int retimeStep;
+
+	bool useLpDiving;
+	double maxDivingTime;
+	double divingIntTol;
+	int divingBatchSize;
+
+	int numDemandSamples;
+	double demandCv;
+	unsigned long long simSeed;
+
+	bool useSsimSchedule;
+	std::string ssimFile;
+	std::string ssimDate;
+
+	// parse products while the network and the rows that do not depend on them are built
+	bool pipelinedStartup;
+
+	// incumbent/bound trace to out/progress.csv, one time-to-gap row per solve in out/time_to_gap.csv
+	bool logProgress;
+	double progressInterval;
+	std::vector<double> progressGapTargets;
+
+	// solve independent station clusters separately; the step is per excess aircraft, 0 takes
+	// the highest hourly fleet cost
+	bool decomposeComponents;
+	int maxCoordinationRounds;
+	double coordinationStep;
+
+	// minimum fleet check on the network before the MIP, see TS_Model::checkFleetSize
+	bool fleetPrecheck;
+
+	// fleet swaps and chain exchanges after the MIP, see LocalSearch
+	bool useLocalSearch;
+	int maxChainLength;
+	double localSearchTime;
+	double localSearchMipTime;
+
+	// fleet-size sweep (main --sweep): fleets by index, all if empty, each from its size - range
+	// to size + range; 0 workers takes the hardware threads
+	std::vector<int> sweepFleets;
+	int sweepRange;
+	int sweepWorkers;
+
+	// network node granularity in minutes, a divisor of 1440; 1 keeps the schedule's own times
+	int timeBucket;
+
+	// saved formulations keyed by a hash of the input, see ModelCache; empty turns the cache off
+	std::string modelCacheDir;
+
+	// --export-mps builds the network on disk in this directory, see FlatNetwork; runs of at most
+	// outOfCoreRunSize leg events are sorted in memory. Empty keeps the network in memory
+	std::string outOfCoreDir;
+	int outOfCoreRunSize;
+
+	// products generated from O&D demand in the input directory, see ItineraryGenerator; the
+	// demand of an O&D is shared by a logit on elapsed time with scale itineraryTimeScale minutes
+	std::string odDemandFile;
+	int maxConnections;
+	int minConnectionTime;
+	int maxConnectionTime;
+	int maxItinerariesPerOd;
+	double itineraryTimeScale;
+
+	// delay propagation over the solved rotations to out/delay.out, see DelaySimulator; seeded
+	// with simSeed, minutes for the mean primary delay and the on-time threshold
+	int numDelaySamples;
+	double delayProbability;
+	double delayMean;
+	double onTimeThreshold;
+
+	// choose the solve strategy and its time limits from the model size and maxRunTime, see
+	// StrategyPlanner; every run is appended to strategyHistory to calibrate the predictions
+	bool autoStrategy;
+	std::string strategyHistory;
+	double strategySafety;
+
+	// the FleetNum rows count the aircraft over countLine (HHMM); the solved counts per station
+	// and fleet go to out/fleet_counts.csv every fleetCountStep minutes, 0 for none, see FleetCountIndex
+	std::string countLine;
+	int fleetCountStep;
+
+	// branching priorities and zero fixes for the MIP from the network, see SolverGuidance; hubs are
+	// the stations with at least guidanceHubShare of the departures
+	bool solverGuidance;
+	double guidanceHubShare;
 };
 
 
@@ -0,0 +1,244 @@
+#include "DelaySimulator.h"
+#include "RevenueSimulator.h"
+#include "TimeUtil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <tuple>
+
+namespace {
+    const int SAMPLES_PER_BLOCK = 1024;
+}
+
+DelaySimulator::DelaySimulator(const std::map<unsigned, unsigned>& assignment, const std::map<unsigned, std::string>& retimedDepartures) :
+    numRotations(0),
+    probability(ParamRegistry::instance()->delayProbability),
+    mean(ParamRegistry::instance()->delayMean),
+    threshold(ParamRegistry::instance()->onTimeThreshold),
+    numSamples(0)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& legs = dataReg->schLegs;
+    const auto& aircrafts = dataReg->aircrafts;
+
+    // (station, fleet) -> (minute, 0 for an aircraft ready / 1 for a departure, leg); ready times
+    // past midnight belong to the next day
+    std::map<std::pair<int, int>, std::vector<std::tuple<int, int, int> > > events;
+    std::map<int, int> depMinute;
+    for (const auto& it : assignment)
+    {
+        const auto leg = legs[it.first];
+        auto itRetimed = retimedDepartures.find(it.first);
+        const int dep = toMinutes(itRetimed != retimedDepartures.end() ? itRetimed->second : leg->getDepTime());
+        const int ready = dep + leg->getDuration() + aircrafts[it.second]->getTurnTime();
+        depMinute[it.first] = dep;
+        events[std::make_pair(leg->getDepStation()->getID(), it.second)].emplace_back(dep, 1, it.first);
+        if (ready < 1440)
+            events[std::make_pair(leg->getArrStation()->getID(), it.second)].emplace_back(ready, 0, it.first);
+    }
+
+    // next[leg]: the leg the aircraft flies after it the same day
+    std::map<int, int> next;
+    std::map<int, double> groundSlack;
+    for (auto& itr : events)
+    {
+        auto& ev = itr.second;
+        std::sort(ev.begin(), ev.end());
+        std::deque<std::pair<int, int> > waiting;    // (ready minute, leg)
+        for (const auto& e : ev)
+        {
+            if (std::get<1>(e) == 0)
+                waiting.emplace_back(std::get<0>(e), std::get<2>(e));
+            else if (!waiting.empty())
+            {
+                next[waiting.front().second] = std::get<2>(e);
+                groundSlack[std::get<2>(e)] = std::get<0>(e) - waiting.front().first;
+                waiting.pop_front();
+            }
+        }
+    }
+
+    // walk the rotations from their first legs, by departure time
+    std::vector<std::pair<int, int> > starts;
+    for (const auto& it : depMinute)
+        if (!groundSlack.count(it.first))
+            starts.emplace_back(it.second, it.first);
+    std::sort(starts.begin(), starts.end());
+    for (const auto& start : starts)
+    {
+        numRotations++;
+        for (int l = start.second; ; )
+        {
+            auto itSlack = groundSlack.find(l);
+            legIndex.push_back(l);
+            legFleet.push_back(static_cast<int>(assignment.at(l)));
+            legStation.push_back(legs[l]->getDepStation()->getID());
+            firstOfDay.push_back(itSlack == groundSlack.end() ? 1 : 0);
+            slack.push_back(itSlack == groundSlack.end() ? 0.0 : itSlack->second);
+            auto itNext = next.find(l);
+            if (itNext == next.end())
+                break;
+            l = itNext->second;
+        }
+    }
+}
+
+void DelaySimulator::simulateBlock(unsigned long long seed, int count, double* delay, double* knockOn, double* onTime) const
+{
+    const int numLegs = static_cast<int>(legIndex.size());
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // arrival delay of the aircraft's previous leg, one per lane
+    alignas(64) double inbound[LANES];
+    alignas(64) double primary[LANES];
+
+    for (int s = 0; s < count; s += LANES)
+    {
+        const int lanes = count - s < LANES ? count - s : LANES;
+        for (int i = 0; i < numLegs; i++)
+        {
+            for (int lane = 0; lane < LANES; lane++)
+            {
+                const double u = uniform(rng);
+                primary[lane] = u < probability ? -mean * std::log(1.0 - uniform(rng)) : 0.0;
+            }
+            if (firstOfDay[i])
+                for (int lane = 0; lane < LANES; lane++)
+                    inbound[lane] = 0.0;
+
+            double sumDelay = 0, sumKnock = 0, sumOnTime = 0;
+            for (int lane = 0; lane < lanes; lane++)
+            {
+                const double knock = std::max(0.0, inbound[lane] - slack[i]);
+                const double dep = knock + primary[lane];
+                inbound[lane] = dep;
+                sumDelay += dep;
+                sumKnock += knock;
+                sumOnTime += dep <= threshold ? 1.0 : 0.0;
+            }
+            delay[i] += sumDelay;
+            knockOn[i] += sumKnock;
+            onTime[i] += sumOnTime;
+        }
+    }
+}
+
+void DelaySimulator::run(int samples, unsigned long long seed, int numThreads)
+{
+    const int numLegs = static_cast<int>(legIndex.size());
+    numSamples = samples;
+    const int numBlocks = (numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    if (numThreads <= 0)
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    numThreads = std::min(numThreads, std::max(1, numBlocks));
+
+    // per thread sums, added up at the end; blocks are seeded by index as in RevenueSimulator
+    std::vector<std::vector<double> > partial(numThreads, std::vector<double>(3 * static_cast<size_t>(numLegs), 0.0));
+    std::atomic<int> nextBlock(0);
+    auto worker = [&](int t) {
+        double* sums = partial[t].data();
+        for (int b = nextBlock++; b < numBlocks; b = nextBlock++)
+        {
+            const int count = std::min(SAMPLES_PER_BLOCK, numSamples - b * SAMPLES_PER_BLOCK);
+            simulateBlock(RevenueSimulator::blockSeed(seed, b), count, sums, sums + numLegs, sums + 2 * numLegs);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : threads)
+        t.join();
+
+    sumDelay.assign(numLegs, 0.0);
+    sumKnockOn.assign(numLegs, 0.0);
+    numOnTime.assign(numLegs, 0.0);
+    for (const auto& sums : partial)
+        for (int i = 0; i < numLegs; i++)
+        {
+            sumDelay[i] += sums[i];
+            sumKnockOn[i] += sums[numLegs + i];
+            numOnTime[i] += sums[2 * numLegs + i];
+        }
+
+    fleetStats = aggregate(legFleet);
+    stationStats = aggregate(legStation);
+}
+
+std::vector<std::pair<int, DelayStats> > DelaySimulator::aggregate(const std::vector<int>& key) const
+{
+    std::map<int, DelayStats> byKey;
+    for (int i = 0; i < static_cast<int>(legIndex.size()); i++)
+    {
+        auto& stats = byKey.emplace(key[i], DelayStats{ 0, 0, 0, 0 }).first->second;
+        stats.legs++;
+        stats.onTime += numOnTime[i];
+        stats.meanDelay += sumDelay[i];
+        stats.meanKnockOn += sumKnockOn[i];
+    }
+    std::vector<std::pair<int, DelayStats> > result;
+    for (auto& it : byKey)
+    {
+        const double n = std::max(1.0, static_cast<double>(it.second.legs) * numSamples);
+        it.second.onTime /= n;
+        it.second.meanDelay /= n;
+        it.second.meanKnockOn /= n;
+        result.push_back(it);
+    }
+    return result;
+}
+
+DelayStats DelaySimulator::getTotal() const
+{
+    DelayStats total = { 0, 0, 0, 0 };
+    for (const auto& it : fleetStats)
+    {
+        total.legs += it.second.legs;
+        total.onTime += it.second.onTime * it.second.legs;
+        total.meanDelay += it.second.meanDelay * it.second.legs;
+        total.meanKnockOn += it.second.meanKnockOn * it.second.legs;
+    }
+    if (total.legs > 0)
+    {
+        total.onTime /= total.legs;
+        total.meanDelay /= total.legs;
+        total.meanKnockOn /= total.legs;
+    }
+    return total;
+}
+
+void DelaySimulator::writeReport(const std::string& filename) const
+{
+    const auto dataReg = DataRegistry::instance();
+    std::ofstream output;
+    output.open(filename.c_str());
+
+    const auto total = getTotal();
+    output << "Samples:\t" << numSamples << std::endl;
+    output << "Rotations:\t" << numRotations << std::endl;
+    output << "Legs:\t" << total.legs << std::endl;
+    output << "On-time departures:\t" << total.onTime << std::endl;
+    output << "Mean delay:\t" << total.meanDelay << std::endl;
+    output << "Mean knock-on delay:\t" << total.meanKnockOn << std::endl;
+    output << "================== Fleets ==================" << std::endl;
+    output << "fleet\tlegs\ton_time\tmean_delay\tmean_knock_on" << std::endl;
+    for (const auto& it : fleetStats)
+        output << dataReg->aircrafts[it.first]->getTail() << "\t" << it.second.legs << "\t" << it.second.onTime << "\t"
+            << it.second.meanDelay << "\t" << it.second.meanKnockOn << std::endl;
+    output << "================== Stations ==================" << std::endl;
+    output << "station\tlegs\ton_time\tmean_delay\tmean_knock_on" << std::endl;
+    for (const auto& it : stationStats)
+    {
+        // station IDs are 1-based positions in the registry
+        output << dataReg->stations[it.first - 1]->getCode() << "\t" << it.second.legs << "\t" << it.second.onTime << "\t"
+            << it.second.meanDelay << "\t" << it.second.meanKnockOn << std::endl;
+    }
+
+    output.close();
+}
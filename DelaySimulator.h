@@ -0,0 +1,65 @@
+#ifndef DELAY_SIMULATOR_H
+#define DELAY_SIMULATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DataManager.h"
+
+struct DelayStats {
+	int legs;
+	double onTime;        // share of departures within onTimeThreshold minutes
+	double meanDelay;     // departure delay, minutes per leg
+	double meanKnockOn;   // the part of it inherited from the previous leg of the aircraft
+};
+
+/* Monte Carlo delay propagation over the rotations of a fleet assignment. Aircraft follow the
+ * legs of their fleet first in, first out at every station, ready after the fleet's turn time; a
+ * rotation starts the day fresh and ends at the last arrival of the day. Every leg may get a
+ * primary departure delay (exponential, with probability delayProbability); a late inbound
+ * aircraft delays the next departure by what exceeds the scheduled ground slack.
+ * Legs are stored flat in rotation order, so a sample is one pass over a few arrays, and LANES
+ * samples run side by side like in RevenueSimulator. */
+class DelaySimulator {
+public:
+	static const int LANES = 8;
+
+	// assignment: leg index -> fleet index; retimed legs depart at their new times
+	DelaySimulator(const std::map<unsigned, unsigned>& assignment, const std::map<unsigned, std::string>& retimedDepartures);
+
+	void run(int numSamples, unsigned long long seed, int numThreads = 0);
+	void writeReport(const std::string& filename) const;
+
+	DelayStats getTotal() const;
+	const std::vector<std::pair<int, DelayStats> >& getFleetStats() const { return fleetStats; }
+	const std::vector<std::pair<int, DelayStats> >& getStationStats() const { return stationStats; }
+
+private:
+	// legs in rotation order
+	std::vector<int> legIndex;
+	std::vector<int> legFleet;
+	std::vector<int> legStation;
+	std::vector<char> firstOfDay;
+	std::vector<double> slack;    // scheduled ground time beyond the turn, 0 for a first leg
+	int numRotations;
+
+	double probability;
+	double mean;
+	double threshold;
+	int numSamples;
+
+	// per leg, summed over all samples
+	std::vector<double> sumDelay;
+	std::vector<double> sumKnockOn;
+	std::vector<double> numOnTime;
+
+	// (fleet or station ID, stats) in ascending key order
+	std::vector<std::pair<int, DelayStats> > fleetStats;
+	std::vector<std::pair<int, DelayStats> > stationStats;
+
+	void simulateBlock(unsigned long long seed, int count, double* delay, double* knockOn, double* onTime) const;
+	std::vector<std::pair<int, DelayStats> > aggregate(const std::vector<int>& key) const;
+};
+
+#endif // !DELAY_SIMULATOR_H
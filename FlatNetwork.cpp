@@ -0,0 +1,272 @@
+#include "FlatNetwork.h"
+#include "DataManager.h"
+#include "TimeUtil.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    namespace io = boost::iostreams;
+
+    // departure (turnClass -1) or arrival of a leg at a network time
+    struct Event {
+        std::int32_t station;
+        std::int32_t minute;
+        std::int32_t leg;
+        std::int32_t turnClass;
+
+        bool operator<(const Event& e) const {
+            return std::tie(station, minute, leg, turnClass) < std::tie(e.station, e.minute, e.leg, e.turnClass);
+        }
+    };
+
+    // sequential reader of a sorted run
+    class RunReader {
+    public:
+        explicit RunReader(const std::string& filename) :
+            input(filename.c_str(), std::ios::binary), pos(0)
+        {
+            fill();
+        }
+        bool done() const { return pos == buffer.size(); }
+        const Event& peek() const { return buffer[pos]; }
+        void pop() { if (++pos == buffer.size()) fill(); }
+
+    private:
+        static const size_t BUFFER_EVENTS = 4096;
+        std::ifstream input;
+        std::vector<Event> buffer;
+        size_t pos;
+
+        void fill()
+        {
+            buffer.resize(BUFFER_EVENTS);
+            input.read(reinterpret_cast<char*>(buffer.data()), BUFFER_EVENTS * sizeof(Event));
+            buffer.resize(static_cast<size_t>(input.gcount()) / sizeof(Event));
+            pos = 0;
+        }
+    };
+
+    std::string runFile(const std::string& directory, int run)
+    {
+        return directory + "run_" + std::to_string(run) + ".bin";
+    }
+
+    // the day wraps as in toTimeString
+    int dayMinute(int minutes)
+    {
+        return ((minutes % 1440) + 1440) % 1440;
+    }
+
+    std::string withSlash(std::string directory)
+    {
+        if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+            directory += '/';
+        return directory;
+    }
+
+    // writable mapping of a new file of `size` bytes; empty files are only created
+    io::mapped_file createMapped(const std::string& filename, size_t size)
+    {
+        if (size == 0)
+        {
+            std::ofstream(filename.c_str(), std::ios::binary | std::ios::trunc);
+            return io::mapped_file();
+        }
+        io::mapped_file_params params(filename);
+        params.new_file_size = static_cast<io::stream_offset>(size);
+        params.flags = io::mapped_file::readwrite;
+        return io::mapped_file(params);
+    }
+}
+
+void FlatNetwork::build(const std::string& dir, size_t runSize)
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto dataReg = DataRegistry::instance();
+    const auto& schLegs = dataReg->schLegs;
+    const auto& aircrafts = dataReg->aircrafts;
+    const std::string directory = withSlash(dir);
+    const int bucket = paramReg->timeBucket;
+    if (bucket < 1 || 1440 % bucket != 0)
+        throw std::invalid_argument("timeBucket must divide a day, got " + std::to_string(bucket));
+    runSize = std::max<size_t>(runSize, 1);
+
+    // turn classes as in TS_Model::buildNetwork
+    std::vector<int> turnClassTimes;
+    for (const auto& ac : aircrafts)
+        turnClassTimes.push_back(ac->getTurnTime());
+    std::sort(turnClassTimes.begin(), turnClassTimes.end());
+    turnClassTimes.erase(std::unique(turnClassTimes.begin(), turnClassTimes.end()), turnClassTimes.end());
+    if (turnClassTimes.empty())
+        turnClassTimes.push_back(0);
+    const int numClasses = static_cast<int>(turnClassTimes.size());
+
+    /* ********************* Sorted Runs ******************** */
+    int numRuns = 0;
+    std::vector<Event> run;
+    run.reserve(runSize);
+    auto flush = [&]() {
+        std::sort(run.begin(), run.end());
+        std::ofstream output(runFile(directory, numRuns++).c_str(), std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(run.data()), run.size() * sizeof(Event));
+        if (!output.good())
+            throw std::runtime_error("cannot write " + runFile(directory, numRuns - 1));
+        run.clear();
+    };
+    auto emit = [&](const Event& e) {
+        run.push_back(e);
+        if (run.size() == runSize)
+            flush();
+    };
+    for (int l = 0; l < static_cast<int>(schLegs.size()); l++)
+    {
+        const auto leg = schLegs[l];
+        emit(Event{ leg->getDepStation()->getID(), dayMinute(bucketDown(toMinutes(leg->getDepTime()), bucket)), l, -1 });
+        for (int c = 0; c < numClasses; c++)
+        {
+            const int ready = bucketUp(toMinutes(leg->getArrTime()) + turnClassTimes[c], bucket);
+            emit(Event{ leg->getArrStation()->getID(), dayMinute(ready), l, c });
+        }
+    }
+    if (!run.empty())
+        flush();
+    std::vector<Event>().swap(run);
+
+    /* ********************* Merge ******************** */
+    const size_t numLegs = schLegs.size();
+    io::mapped_file flightFile = createMapped(flightArcsFile(directory), numLegs * sizeof(FlatArc));
+    io::mapped_file shiftedFile = createMapped(shiftedHeadsFile(directory), numLegs * (numClasses - 1) * sizeof(std::int32_t));
+    auto flightArcs = reinterpret_cast<FlatArc*>(flightFile.is_open() ? flightFile.data() : nullptr);
+    auto shiftedHeads = reinterpret_cast<std::int32_t*>(shiftedFile.is_open() ? shiftedFile.data() : nullptr);
+    std::ofstream nodeOutput(nodesFile(directory).c_str(), std::ios::binary | std::ios::trunc);
+    std::ofstream groundOutput(groundArcsFile(directory).c_str(), std::ios::binary | std::ios::trunc);
+
+    std::vector<RunReader*> readers;
+    for (int r = 0; r < numRuns; r++)
+        readers.push_back(new RunReader(runFile(directory, r)));
+    // (event, run) with the smallest event on top
+    typedef std::pair<Event, int> Head;
+    auto later = [](const Head& a, const Head& b) -> bool { return b.first < a.first; };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+    for (int r = 0; r < numRuns; r++)
+        if (!readers[r]->done())
+            heads.emplace(readers[r]->peek(), r);
+
+    int numNodes = 0;
+    int numGroundArcs = 0;
+    FlatNode current = { -1, -1 };
+    int firstOfStation = -1;
+    auto addGroundArc = [&](int tail, int head) {
+        const FlatArc arc = { tail, head, -1 };
+        groundOutput.write(reinterpret_cast<const char*>(&arc), sizeof(arc));
+        numGroundArcs++;
+    };
+    while (!heads.empty())
+    {
+        const Event e = heads.top().first;
+        const int r = heads.top().second;
+        heads.pop();
+        readers[r]->pop();
+        if (!readers[r]->done())
+            heads.emplace(readers[r]->peek(), r);
+
+        if (e.station != current.station || e.minute != current.minute)
+        {
+            if (e.station != current.station)
+            {
+                // the station before wraps around midnight
+                if (firstOfStation >= 0)
+                    addGroundArc(numNodes - 1, firstOfStation);
+                firstOfStation = numNodes;
+            }
+            else
+                addGroundArc(numNodes - 1, numNodes);
+            current = FlatNode{ e.station, e.minute };
+            nodeOutput.write(reinterpret_cast<const char*>(&current), sizeof(current));
+            numNodes++;
+        }
+
+        const int node = numNodes - 1;
+        auto& arc = flightArcs[e.leg];
+        arc.leg = e.leg;
+        if (e.turnClass < 0)
+            arc.tail = node;
+        else if (e.turnClass == 0)
+            arc.head = node;
+        else
+            shiftedHeads[static_cast<size_t>(e.leg) * (numClasses - 1) + e.turnClass - 1] = node;
+    }
+    if (firstOfStation >= 0)
+        addGroundArc(numNodes - 1, firstOfStation);
+
+    for (int r = 0; r < numRuns; r++)
+    {
+        delete readers[r];
+        std::remove(runFile(directory, r).c_str());
+    }
+    nodeOutput.close();
+    groundOutput.close();
+    if (!nodeOutput.good() || !groundOutput.good())
+        throw std::runtime_error("cannot write the network to " + directory);
+
+    std::ofstream header(headerFile(directory).c_str());
+    header << numNodes << " " << numLegs << " " << numGroundArcs << "\n" << numClasses;
+    for (int t : turnClassTimes)
+        header << " " << t;
+    header << "\n" << aircrafts.size();
+    for (const auto& ac : aircrafts)
+        header << " " << (std::lower_bound(turnClassTimes.begin(), turnClassTimes.end(), ac->getTurnTime()) - turnClassTimes.begin());
+    header << "\n";
+}
+
+FlatNetwork::FlatNetwork(const std::string& dir) :
+    numNodes(0),
+    numFlightArcs(0),
+    numGroundArcs(0),
+    nodes(nullptr),
+    flightArcs(nullptr),
+    groundArcs(nullptr),
+    shiftedHeads(nullptr)
+{
+    const std::string directory = withSlash(dir);
+    std::ifstream header(headerFile(directory).c_str());
+    int numClasses = 0;
+    size_t numFleets = 0;
+    header >> numNodes >> numFlightArcs >> numGroundArcs >> numClasses;
+    turnClassTimes.resize(std::max(numClasses, 0));
+    for (auto& t : turnClassTimes)
+        header >> t;
+    header >> numFleets;
+    fleetTurnClass.resize(numFleets);
+    for (auto& c : fleetTurnClass)
+        header >> c;
+    if (!header || numClasses < 1)
+        throw std::runtime_error("cannot read " + headerFile(directory));
+
+    // empty files cannot be mapped
+    if (numNodes > 0)
+    {
+        nodeFile.open(nodesFile(directory));
+        nodes = reinterpret_cast<const FlatNode*>(nodeFile.data());
+    }
+    if (numFlightArcs > 0)
+    {
+        flightFile.open(flightArcsFile(directory));
+        flightArcs = reinterpret_cast<const FlatArc*>(flightFile.data());
+    }
+    if (numGroundArcs > 0)
+    {
+        groundFile.open(groundArcsFile(directory));
+        groundArcs = reinterpret_cast<const FlatArc*>(groundFile.data());
+    }
+    if (numFlightArcs > 0 && numClasses > 1)
+    {
+        shiftedFile.open(shiftedHeadsFile(directory));
+        shiftedHeads = reinterpret_cast<const std::int32_t*>(shiftedFile.data());
+    }
+}
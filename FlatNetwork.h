@@ -0,0 +1,73 @@
+#ifndef FLAT_NETWORK_H
+#define FLAT_NETWORK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// records of the network files; a node's ID is its position, nodes are by station, then time
+struct FlatNode {
+	std::int32_t station;
+	std::int32_t minute;
+};
+
+struct FlatArc {
+	std::int32_t tail;
+	std::int32_t head;
+	std::int32_t leg;    // index in DataRegistry::schLegs, -1 for a ground arc
+};
+
+/* Time-space network of all legs on disk, for schedules whose node and arc objects would not fit
+ * in memory. build() emits a departure event and an arrival event per turn class for every leg,
+ * sorts them by (station, time) in runs of at most runSize events and merges the runs into the
+ * node file, the ground arcs between consecutive nodes of a station (the last one wrapping to the
+ * first) and the flight arcs, one per leg, in leg order. Flight arcs and shifted heads are filled
+ * in place in mapped files. Readers map the files and keep nothing else resident; the layout is
+ * that of TS_Model::buildNetwork except for the node IDs, which follow the station order. */
+class FlatNetwork {
+public:
+	static void build(const std::string& directory, size_t runSize);
+
+	// maps the files written by build() into `directory`
+	explicit FlatNetwork(const std::string& directory);
+
+	int getNumNodes() const { return numNodes; }
+	int getNumFlightArcs() const { return numFlightArcs; }
+	int getNumGroundArcs() const { return numGroundArcs; }
+	const FlatNode& getNode(int n) const { return nodes[n]; }
+	const FlatArc& getFlightArc(int i) const { return flightArcs[i]; }
+	const FlatArc& getGroundArc(int g) const { return groundArcs[g]; }
+
+	// arrival node of flight arc `arc` when flown by fleet `k`, as TS_Model::getArcHead
+	int getArcHead(int arc, int k) const {
+		const int c = fleetTurnClass[k];
+		if (c == 0)
+			return flightArcs[arc].head;
+		return shiftedHeads[static_cast<size_t>(arc) * (turnClassTimes.size() - 1) + c - 1];
+	}
+
+private:
+	int numNodes;
+	int numFlightArcs;
+	int numGroundArcs;
+	std::vector<int> turnClassTimes;
+	std::vector<int> fleetTurnClass;
+
+	boost::iostreams::mapped_file_source nodeFile;
+	boost::iostreams::mapped_file_source flightFile;
+	boost::iostreams::mapped_file_source groundFile;
+	boost::iostreams::mapped_file_source shiftedFile;
+	const FlatNode* nodes;
+	const FlatArc* flightArcs;
+	const FlatArc* groundArcs;
+	const std::int32_t* shiftedHeads;
+
+	static std::string headerFile(const std::string& directory) { return directory + "network.hdr"; }
+	static std::string nodesFile(const std::string& directory) { return directory + "nodes.bin"; }
+	static std::string flightArcsFile(const std::string& directory) { return directory + "flight_arcs.bin"; }
+	static std::string groundArcsFile(const std::string& directory) { return directory + "ground_arcs.bin"; }
+	static std::string shiftedHeadsFile(const std::string& directory) { return directory + "shifted_heads.bin"; }
+};
+
+#endif // !FLAT_NETWORK_H
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// Per-arc fleet data (cost, capacity, flow, eligibility) in aligned blocks of W lanes, one lane per
+// fleet. W is 4, 8 or 16 by the fleet count, see dispatchFleetWidth; more than 16 fleets take
+// several blocks per arc. Padding lanes hold zeros, so sums are unaffected and a padding lane is
+// never eligible. The kernels below loop over the lanes with a compile-time trip count.
+template<int W>
+struct alignas(W * sizeof(double)) FleetBlock {
+	double v[W];
+};
+
+template<int W>
+class FleetArcTable {
+private:
+	int numBlocks;
+	std::vector<FleetBlock<W> > blocks;
+
+public:
+	FleetArcTable(int numArcs, int numFleets) :
+		numBlocks((numFleets + W - 1) / W),
+		blocks(static_cast<size_t>(numArcs) * ((numFleets + W - 1) / W), FleetBlock<W>()) {}
+
+	int getNumBlocks() const { return numBlocks; }
+	FleetBlock<W>* row(int arc) { return blocks.data() + static_cast<size_t>(arc) * numBlocks; }
+	const FleetBlock<W>* row(int arc) const { return blocks.data() + static_cast<size_t>(arc) * numBlocks; }
+	double& at(int arc, int k) { return row(arc)[k / W].v[k % W]; }
+	double at(int arc, int k) const { return row(arc)[k / W].v[k % W]; }
+};
+
+// calls f(std::integral_constant<int, W>()) with the block width for numFleets fleets
+template<class F>
+auto dispatchFleetWidth(int numFleets, F&& f) -> decltype(f(std::integral_constant<int, 4>()))
+{
+	if (numFleets <= 4)
+		return f(std::integral_constant<int, 4>());
+	if (numFleets <= 8)
+		return f(std::integral_constant<int, 8>());
+	return f(std::integral_constant<int, 16>());
+}
+
+// sum of a[k] * b[k], e.g. flows times cost
+template<int W>
+double fleetDot(const FleetBlock<W>* a, const FleetBlock<W>* b, int numBlocks)
+{
+	FleetBlock<W> acc = FleetBlock<W>();
+	for (int j = 0; j < numBlocks; j++)
+		for (int k = 0; k < W; k++)
+			acc.v[k] += a[j].v[k] * b[j].v[k];
+	double sum = 0;
+	for (int k = 0; k < W; k++)
+		sum += acc.v[k];
+	return sum;
+}
+
+// y[k] += s * x[k], e.g. an arc's flows into the balance of its head (1) or tail (-1)
+template<int W>
+void fleetAxpy(FleetBlock<W>* y, double s, const FleetBlock<W>* x, int numBlocks)
+{
+	for (int j = 0; j < numBlocks; j++)
+		for (int k = 0; k < W; k++)
+			y[j].v[k] += s * x[j].v[k];
+}
+
+// y[k] += s * mask[k] * x[k], for values that only apply to some fleets, such as a turn class
+template<int W>
+void fleetMaskedAxpy(FleetBlock<W>* y, double s, const FleetBlock<W>* mask, const FleetBlock<W>* x, int numBlocks)
+{
+	for (int j = 0; j < numBlocks; j++)
+		for (int k = 0; k < W; k++)
+			y[j].v[k] += s * mask[j].v[k] * x[j].v[k];
+}
+
+// largest a[k] over the fleets with eligible[k] != 0, -infinity if there is none
+template<int W>
+double fleetMax(const FleetBlock<W>* a, const FleetBlock<W>* eligible, int numBlocks)
+{
+	const double none = -std::numeric_limits<double>::infinity();
+	FleetBlock<W> best;
+	for (int k = 0; k < W; k++)
+		best.v[k] = none;
+	for (int j = 0; j < numBlocks; j++)
+		for (int k = 0; k < W; k++)
+		{
+			const double x = eligible[j].v[k] != 0 ? a[j].v[k] : none;
+			best.v[k] = best.v[k] < x ? x : best.v[k];
+		}
+	double result = none;
+	for (int k = 0; k < W; k++)
+		result = result < best.v[k] ? best.v[k] : result;
+	return result;
+}
+
+// largest |a[k]|, e.g. the flow balance residual of a node
+template<int W>
+double fleetMaxAbs(const FleetBlock<W>* a, int numBlocks)
+{
+	FleetBlock<W> best = FleetBlock<W>();
+	for (int j = 0; j < numBlocks; j++)
+		for (int k = 0; k < W; k++)
+		{
+			const double x = a[j].v[k] < 0 ? -a[j].v[k] : a[j].v[k];
+			best.v[k] = best.v[k] < x ? x : best.v[k];
+		}
+	double result = 0;
+	for (int k = 0; k < W; k++)
+		result = result < best.v[k] ? best.v[k] : result;
+	return result;
+}
@@ -0,0 +1,119 @@
+#include "FleetCountIndex.h"
+#include "DataManager.h"
+#include "TimeUtil.h"
+
+#include <algorithm>
+#include <fstream>
+
+FleetCountIndex::FleetCountIndex(const std::map<unsigned, unsigned>& assignment, const std::map<unsigned, std::string>& retimedDepartures)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& legs = dataReg->schLegs;
+    const auto& aircrafts = dataReg->aircrafts;
+
+    // (minute, +1 / -1) per station and fleet, and per fleet for the air
+    std::map<std::pair<int, int>, std::vector<std::pair<int, int> > > groundEvents;
+    std::vector<std::vector<std::pair<int, int> > > airEvents(aircrafts.size());
+    std::vector<int> overMidnight(aircrafts.size(), 0);
+    for (const auto& it : assignment)
+    {
+        const auto leg = legs[it.first];
+        const int k = static_cast<int>(it.second);
+        auto itRetimed = retimedDepartures.find(it.first);
+        const int dep = toMinutes(itRetimed != retimedDepartures.end() ? itRetimed->second : leg->getDepTime());
+        const int ready = dep + leg->getDuration() + aircrafts[k]->getTurnTime();
+        const int depStation = leg->getDepStation()->getID();
+        const int arrStation = leg->getArrStation()->getID();
+        stations[depStation] = leg->getDepStation();
+        stations[arrStation] = leg->getArrStation();
+
+        groundEvents[std::make_pair(depStation, k)].emplace_back(dep % 1440, -1);
+        groundEvents[std::make_pair(arrStation, k)].emplace_back(ready % 1440, 1);
+        airEvents[k].emplace_back(dep % 1440, 1);
+        airEvents[k].emplace_back(ready % 1440, -1);
+        // a flight still turning at the end of the day starts the next one in the air
+        overMidnight[k] += ready / 1440;
+    }
+
+    for (auto& itr : groundEvents)
+    {
+        auto series = sum(itr.second, 0);
+        const int lowest = *std::min_element(series.counts.begin(), series.counts.end());
+        for (auto& c : series.counts)
+            c -= std::min(lowest, 0);
+        ground[itr.first] = series;
+    }
+    for (size_t k = 0; k < aircrafts.size(); k++)
+        airborne.push_back(sum(airEvents[k], overMidnight[k]));
+}
+
+FleetCountIndex::Series FleetCountIndex::sum(std::vector<std::pair<int, int> >& events, int initial)
+{
+    std::sort(events.begin(), events.end());
+    Series series;
+    int level = initial;
+    for (const auto& e : events)
+    {
+        level += e.second;
+        if (!series.minutes.empty() && series.minutes.back() == e.first)
+            series.counts.back() = level;
+        else
+        {
+            series.minutes.push_back(e.first);
+            series.counts.push_back(level);
+        }
+    }
+    return series;
+}
+
+int FleetCountIndex::count(const Series& series, int minute)
+{
+    if (series.counts.empty())
+        return 0;
+    minute = ((minute % 1440) + 1440) % 1440;
+    const auto it = std::upper_bound(series.minutes.begin(), series.minutes.end(), minute);
+    return it == series.minutes.begin() ? series.counts.back() : series.counts[it - series.minutes.begin() - 1];
+}
+
+int FleetCountIndex::getOnGround(int station, int k, int minute) const
+{
+    auto it = ground.find(std::make_pair(station, k));
+    return it == ground.end() ? 0 : count(it->second, minute);
+}
+
+int FleetCountIndex::getAirborne(int k, int minute) const
+{
+    return count(airborne[k], minute);
+}
+
+int FleetCountIndex::getInUse(int k) const
+{
+    int total = getAirborne(k, 0);
+    for (const auto& itr : ground)
+        if (itr.first.second == k)
+            total += count(itr.second, 0);
+    return total;
+}
+
+void FleetCountIndex::writeCounts(const std::string& filename, int step) const
+{
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    std::ofstream output;
+    output.open(filename.c_str());
+
+    output << "time,fleet,station,count" << std::endl;
+    for (int t = 0; t < 1440; t += std::max(step, 1))
+    {
+        const std::string time = toTimeString(t);
+        for (int k = 0; k < static_cast<int>(aircrafts.size()); k++)
+        {
+            for (const auto& itr : ground)
+                if (itr.first.second == k)
+                    output << time << "," << aircrafts[k]->getTail() << "," << stations.at(itr.first.first)->getCode()
+                        << "," << count(itr.second, t) << std::endl;
+            output << time << "," << aircrafts[k]->getTail() << ",AIR," << count(airborne[k], t) << std::endl;
+        }
+    }
+
+    output.close();
+}
@@ -0,0 +1,47 @@
+#ifndef FLEET_COUNT_INDEX_H
+#define FLEET_COUNT_INDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Station;
+
+/* Aircraft counts over the day of a fleet assignment. A flight holds its aircraft from departure
+ * until the fleet's turn is complete, the same [from, to) as TS_Model::crossesTime, so every
+ * aircraft in use is either airborne or on the ground at one station at any minute. Per station
+ * and fleet the departures and ready times are sorted once and summed, starting from the fewest
+ * aircraft that keep the count from going negative (those parked there at midnight); per fleet
+ * the same is done for the aircraft in the air, starting from the flights over midnight. A query
+ * is a binary search in one of these prefix sums. */
+class FleetCountIndex {
+public:
+	// assignment: leg index -> fleet index; retimed legs depart at their new times
+	FleetCountIndex(const std::map<unsigned, unsigned>& assignment, const std::map<unsigned, std::string>& retimedDepartures);
+
+	// minutes after midnight, taken modulo the day; station by ID
+	int getOnGround(int station, int k, int minute) const;
+	int getAirborne(int k, int minute) const;
+	// aircraft of fleet k the assignment needs, the same at every minute
+	int getInUse(int k) const;
+
+	// time,fleet,station,count every `step` minutes, the station AIR for the aircraft in the air
+	void writeCounts(const std::string& filename, int step) const;
+
+private:
+	// counts[i] holds from minutes[i] until the next entry; before the first it is counts.back()
+	struct Series {
+		std::vector<int> minutes;
+		std::vector<int> counts;
+	};
+
+	// (station ID, fleet)
+	std::map<std::pair<int, int>, Series> ground;
+	std::map<int, Station*> stations;
+	std::vector<Series> airborne;
+
+	static Series sum(std::vector<std::pair<int, int> >& events, int initial);
+	static int count(const Series& series, int minute);
+};
+
+#endif // !FLEET_COUNT_INDEX_H
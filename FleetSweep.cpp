@@ -0,0 +1,165 @@
+#include "FleetSweep.h"
+#include "DataManager.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <thread>
+
+FleetSweep::FleetSweep(const std::string& inputDirectory, const std::string& outputDirectory) :
+    input_directory(inputDirectory),
+    output_directory(outputDirectory)
+{}
+
+std::vector<std::pair<int, int> > FleetSweep::makeRuns(int numWorkers) const
+{
+    // the points of one fleet are contiguous, a fleet gets split when there are more workers than fleets
+    std::vector<std::pair<int, int> > fleetRanges;
+    for (int i = 0; i < static_cast<int>(points.size()); i++)
+    {
+        if (i == 0 || points[i].fleet != points[i - 1].fleet)
+            fleetRanges.emplace_back(i, i);
+        fleetRanges.back().second = i + 1;
+    }
+
+    std::vector<std::pair<int, int> > runs;
+    const int numFleets = static_cast<int>(fleetRanges.size());
+    const int piecesPerFleet = std::max(1, (numWorkers + numFleets - 1) / std::max(1, numFleets));
+    for (const auto& range : fleetRanges)
+    {
+        const int length = range.second - range.first;
+        const int pieces = std::min(piecesPerFleet, length);
+        for (int j = 0; j < pieces; j++)
+            runs.emplace_back(range.first + length * j / pieces, range.first + length * (j + 1) / pieces);
+    }
+    return runs;
+}
+
+void FleetSweep::run()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto dataReg = DataRegistry::instance();
+    if (dataReg->schLegs.empty())
+        dataReg->readInputDataFile(input_directory);
+    const auto& aircrafts = dataReg->aircrafts;
+
+    std::vector<int> fleets = paramReg->sweepFleets;
+    if (fleets.empty())
+        for (int k = 0; k < static_cast<int>(aircrafts.size()); k++)
+            fleets.push_back(k);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    points.clear();
+    for (int k : fleets)
+    {
+        if (k < 0 || k >= static_cast<int>(aircrafts.size()))
+            throw std::out_of_range("sweep fleet " + std::to_string(k) + " is not registered");
+        const int base = aircrafts[k]->getNumAircrafts();
+        for (int n = std::max(0, base - paramReg->sweepRange); n <= base + paramReg->sweepRange; n++)
+            points.push_back(Point{ k, n, "", nan, nan, nan, 0 });
+    }
+    if (points.empty())
+        return;
+
+    const int hwThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int numWorkers = paramReg->sweepWorkers > 0 ? paramReg->sweepWorkers : hwThreads;
+    const auto runs = makeRuns(numWorkers);
+    numWorkers = std::min(numWorkers, static_cast<int>(runs.size()));
+    const int cplexThreads = std::max(1, hwThreads / numWorkers);
+
+    // without a cached formulation worker 0 builds and saves it alone, the others then load it
+    const ModelCache cache(input_directory);
+    const bool firstBuildsCache = cache.enabled() && !cache.contains();
+    std::promise<void> cacheBuilt;
+    const std::shared_future<void> cacheReady = cacheBuilt.get_future().share();
+
+    std::atomic<int> next(0);
+    auto worker = [&](int w) {
+        bool released = !firstBuildsCache || w > 0;
+        try
+        {
+            TS_Model model(input_directory);
+            model.setOutputDirectory(output_directory + "s" + std::to_string(w) + "_");
+            if (firstBuildsCache && w > 0)
+                cacheReady.wait();
+            model.buildModel();
+            if (!released)
+            {
+                cacheBuilt.set_value();
+                released = true;
+            }
+            model.getCplex().setParam(IloCplex::Param::Threads, cplexThreads);
+
+            for (int r = next++; r < static_cast<int>(runs.size()); r = next++)
+            {
+                const int k = points[runs[r].first].fleet;
+                for (int i = runs[r].first; i < runs[r].second; i++)
+                {
+                    auto& point = points[i];
+                    model.setFleetSize(k, point.size);
+                    model.solve();
+                    point.cpuTime = model.getCpuTime();
+                    if (model.hasFleetShortage())
+                    {
+                        point.status = "Precheck";
+                        continue;
+                    }
+                    if (!model.hasSolution())
+                    {
+                        point.status = "NoSolution";
+                        continue;
+                    }
+                    auto& cplex = model.getCplex();
+                    point.status = cplex.getStatus() == IloAlgorithm::Optimal ? "Optimal" : "Feasible";
+                    point.objective = cplex.getObjValue();
+                    point.bound = cplex.getBestObjValue();
+                    point.gap = cplex.getMIPRelativeGap();
+                    model.addSolutionAsStart();
+                }
+                model.setFleetSize(k, aircrafts[k]->getNumAircrafts());
+            }
+        }
+        catch (const IloException& e)
+        {
+            cerr << "Sweep worker " << w << ": exception caught: " << e << endl;
+        }
+        catch (const std::exception& e)
+        {
+            cerr << "Sweep worker " << w << ": " << e.what() << endl;
+        }
+        if (!released)
+            cacheBuilt.set_value();
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < numWorkers; w++)
+        threads.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : threads)
+        t.join();
+
+    if (paramReg->printAlgProcess)
+        for (const auto& point : points)
+            cout << "Sweep " << aircrafts[point.fleet]->getTail() << " x " << point.size << ": " << point.status
+                << " " << point.objective << endl;
+}
+
+void FleetSweep::writeTable(const std::string& filename) const
+{
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    std::ofstream output(filename.c_str());
+    output << "fleet,size,change,status,objective,bound,gap,cpu_time" << std::endl;
+    for (const auto& point : points)
+    {
+        output << aircrafts[point.fleet]->getTail() << "," << point.size << ","
+            << point.size - aircrafts[point.fleet]->getNumAircrafts() << "," << point.status << ",";
+        // points without a solution leave the numbers empty
+        if (!std::isnan(point.objective))
+            output << point.objective << "," << point.bound << "," << point.gap;
+        else
+            output << ",,";
+        output << "," << point.cpuTime << std::endl;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef FLEET_SWEEP_H
+#define FLEET_SWEEP_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TS_Model.h"
+
+/* Profit as the size of one fleet varies, the others at their ac.csv sizes. Every worker builds
+ * the model once and then only moves the right-hand side of FleetNum; its points run in ascending
+ * fleet size, so the solution of the previous point still fits and is the MIP start of the next.
+ * Workers have their own environments and share the points of a fleet in contiguous runs. */
+class FleetSweep {
+public:
+	struct Point {
+		int fleet;
+		int size;
+		std::string status;
+		double objective;
+		double bound;
+		double gap;
+		double cpuTime;
+	};
+
+	FleetSweep(const std::string& inputDirectory, const std::string& outputDirectory);
+
+	void run();
+	void writeTable(const std::string& filename) const;
+
+	const std::vector<Point>& getPoints() const { return points; }
+
+private:
+	std::string input_directory;
+	std::string output_directory;
+	std::vector<Point> points;
+
+	// runs of consecutive points of one fleet, [first, last) into points
+	std::vector<std::pair<int, int> > makeRuns(int numWorkers) const;
+};
+
+#endif // !FLEET_SWEEP_H
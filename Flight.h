@@ -8,7 +8,7 @@
 class Flight {
 private:
 
-	std::string fltNumber;
+	int fltNumID;
 	unsigned fltID;
 
 	Station* depStation;
@@ -22,9 +22,9 @@ private:
 	Aircraft* aircraft;
 
 public:
-	Flight(unsigned id, std::string fnum, Station* depS, Station* arrS, std::string depT, std::string arrT, Aircraft* ac, int dura) :
+	Flight(unsigned id, int fnumID, Station* depS, Station* arrS, std::string depT, std::string arrT, Aircraft* ac, int dura) :
 		fltID(id),
-		fltNumber(fnum),
+		fltNumID(fnumID),
 		depStation(depS),
 		arrStation(arrS),
 		depTime(depT),
@@ -43,7 +43,7 @@ public:
 	void setID(int id) { fltID = id; }
 	unsigned getID() const { return fltID; }
 
-	std::string& getFlightNum() { return fltNumber; }
+	int getFlightNumID() const { return fltNumID; }
 
 	Station* getArrStation() const { return arrStation; }
 	Station* getDepStation() const { return depStation; }
@@ -60,7 +60,9 @@ public:
 class Leg {
 private:
 	Flight* flt;
-	std::string fltNumber;
+	// interned in DataRegistry::fltNumbers
+	const std::string* fltNumber;
+	int fltNumID;
 
 	std::string depTime;
 	std::string arrTime;
@@ -71,19 +73,22 @@ private:
 	Aircraft* aircraft;
 
 	int legID;
+	int legIndex;
 	int duration;
 
 public:
-	Leg(std::string fN, std::string _depTime, std::string _arrTime, Station* dS, Station* aS, int d, int id) :
+	Leg(const std::string& fN, int fnID, std::string _depTime, std::string _arrTime, Station* dS, Station* aS, int d, int id) :
 		flt(nullptr),
-		fltNumber(fN),
+		fltNumber(&fN),
+		fltNumID(fnID),
 		depTime(_depTime),
 		arrTime(_arrTime),
 		depStation(dS),
 		arrStation(aS),
-		duration(d),
-		legID(id), 
-		aircraft(nullptr)
+		aircraft(nullptr),
+		legID(id),
+		legIndex(-1),
+		duration(d)
 	{}
 	bool operator==(const Leg& leg) const {
 		return (this->getFltID() == leg.getFltID() && this->getDepTime() == leg.getDepTime());
@@ -91,7 +96,8 @@ public:
 
 	Flight* getFlight() const { return flt; }
 	long getFltID() const { return flt->getID(); }
-	std::string& getFlightNum() { return fltNumber; }
+	const std::string& getFlightNum() const { return *fltNumber; }
+	int getFltNumID() const { return fltNumID; }
 
 	Station* getArrStation() const { return arrStation; }
 	Station* getDepStation() const { return depStation; }
@@ -101,6 +107,8 @@ public:
 
 	int getDuration() const { return duration; }
 	int getID() const { return legID; }
+	int getIndex() const { return legIndex; }
+	void setIndex(int i) { legIndex = i; }
 	Aircraft* getAircraft() const { return  flt->getAircraft(); }
 	
 
@@ -0,0 +1,171 @@
+#include "ItineraryGenerator.h"
+#include "DataManager.h"
+#include "TimeUtil.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <thread>
+#include "boost/algorithm/string.hpp"
+
+ItineraryGenerator::ItineraryGenerator(int maxConn, int minConnTime, int maxConnTime) :
+    maxConnections(maxConn),
+    minConnectionTime(minConnTime),
+    maxConnectionTime(std::min(maxConnTime, 1439))
+{
+    buildIndex();
+}
+
+void ItineraryGenerator::buildIndex()
+{
+    const auto dataReg = DataRegistry::instance();
+    departures.clear();
+    for (const auto station : dataReg->stations)
+    {
+        auto& index = departures[station->getID()];
+        for (const auto leg : station->getDepLegs())
+            index.emplace_back(toMinutes(leg->getDepTime()), leg->getIndex());
+        std::sort(index.begin(), index.end());
+    }
+}
+
+void ItineraryGenerator::readOdFile(const std::string& filename)
+{
+    const auto dataReg = DataRegistry::instance();
+    std::ifstream input(filename.c_str());
+    std::string line;
+    std::getline(input, line);
+    while (std::getline(input, line))
+    {
+        std::vector<std::string> vals;
+        boost::split(vals, line, boost::is_any_of(","));
+        if (vals.size() < 4)
+            continue;
+        ods.push_back(OdDemand{ dataReg->getOrCreateStation(vals[0]), dataReg->getOrCreateStation(vals[1]),
+            std::stod(vals[2]), std::stod(vals[3]) });
+    }
+}
+
+/* Depth first from the last arrival: the departures in the connection window, on the day of the
+ * arrival and, when the window passes midnight, on the next day. Stations are not revisited. */
+void ItineraryGenerator::extend(Itinerary& path, int arrival, const Station* at, const Station* destination,
+    std::vector<const Station*>& visited, std::vector<Itinerary>& found) const
+{
+    const auto& schLegs = DataRegistry::instance()->schLegs;
+    if (at == destination)
+    {
+        found.push_back(path);
+        return;
+    }
+    if (static_cast<int>(path.legs.size()) > maxConnections)
+        return;
+    auto itIndex = departures.find(at->getID());
+    if (itIndex == departures.end())
+        return;
+    const auto& index = itIndex->second;
+
+    const int earliest = arrival + minConnectionTime;
+    const int latest = arrival + maxConnectionTime;
+    for (int day = earliest / 1440; day * 1440 <= latest; day++)
+    {
+        const int from = std::max(earliest - day * 1440, 0);
+        const int to = latest - day * 1440;
+        auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(from, -1));
+        for (; it != index.end() && it->first <= to; ++it)
+        {
+            const auto leg = schLegs[it->second];
+            const auto next = leg->getArrStation();
+            if (std::find(visited.begin(), visited.end(), next) != visited.end())
+                continue;
+            const int departure = day * 1440 + it->first;
+            path.legs.push_back(it->second);
+            path.elapsed += departure - arrival + leg->getDuration();
+            visited.push_back(next);
+            extend(path, departure + leg->getDuration(), next, destination, visited, found);
+            visited.pop_back();
+            path.elapsed -= departure - arrival + leg->getDuration();
+            path.legs.pop_back();
+        }
+    }
+}
+
+std::vector<ItineraryGenerator::Itinerary> ItineraryGenerator::enumerate(const Station* origin,
+    const Station* destination, int maxItineraries) const
+{
+    const auto& schLegs = DataRegistry::instance()->schLegs;
+    std::vector<Itinerary> found;
+    if (origin == destination)
+        return found;
+    auto itIndex = departures.find(origin->getID());
+    if (itIndex == departures.end())
+        return found;
+
+    std::vector<const Station*> visited(1, origin);
+    Itinerary path{ {}, 0 };
+    for (const auto& dep : itIndex->second)
+    {
+        const auto leg = schLegs[dep.second];
+        path.legs.assign(1, dep.second);
+        path.elapsed = leg->getDuration();
+        visited.push_back(leg->getArrStation());
+        extend(path, dep.first + leg->getDuration(), leg->getArrStation(), destination, visited, found);
+        visited.pop_back();
+    }
+
+    std::stable_sort(found.begin(), found.end(), [](const Itinerary& a, const Itinerary& b) -> bool {
+        return a.elapsed < b.elapsed || (a.elapsed == b.elapsed && a.legs.size() < b.legs.size());
+        });
+    if (maxItineraries > 0 && static_cast<int>(found.size()) > maxItineraries)
+        found.resize(maxItineraries);
+    return found;
+}
+
+int ItineraryGenerator::generate(int maxItineraries, double timeScale, int numThreads)
+{
+    const auto dataReg = DataRegistry::instance();
+    const int numOds = static_cast<int>(ods.size());
+    if (numThreads <= 0)
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    numThreads = std::max(1, std::min(numThreads, numOds));
+
+    std::vector<std::vector<Itinerary> > itineraries(numOds);
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < numOds; i = next++)
+            itineraries[i] = enumerate(ods[i].origin, ods[i].destination, maxItineraries);
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    // the arena and the product list are not shared, products are created on this thread
+    int created = 0;
+    for (int i = 0; i < numOds; i++)
+    {
+        const auto& found = itineraries[i];
+        if (found.empty())
+            continue;
+        std::vector<double> weights;
+        double total = 0;
+        for (const auto& itin : found)
+        {
+            weights.push_back(timeScale > 0 ? std::exp(-(itin.elapsed - found.front().elapsed) / timeScale) : 1.0);
+            total += weights.back();
+        }
+        for (size_t j = 0; j < found.size(); j++)
+        {
+            auto pPro = dataReg->productArena.create(ods[i].origin, ods[i].destination, ods[i].fare,
+                ods[i].demand * weights[j] / total);
+            for (int l : found[j].legs)
+                pPro->addLeg(l);
+            dataReg->products.push_back(pPro);
+            pPro->setID(static_cast<int>(dataReg->products.size()));
+            created++;
+        }
+    }
+    return created;
+}
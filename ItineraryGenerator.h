@@ -0,0 +1,54 @@
+#ifndef ITINERARY_GENERATOR_H
+#define ITINERARY_GENERATOR_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Station;
+
+/* Products from O&D demand: every itinerary of up to maxConnections connections whose connection
+ * times lie within [minConnectionTime, maxConnectionTime] minutes, on a daily schedule that repeats,
+ * so a connection may pass midnight. Departures are indexed per station and sorted by time, a
+ * connection is a range lookup in that index. O&D pairs are enumerated in parallel; the best
+ * itineraries by elapsed time become products that share the O&D demand by a logit on the elapsed
+ * time and carry the O&D fare. */
+class ItineraryGenerator {
+public:
+	struct OdDemand {
+		Station* origin;
+		Station* destination;
+		double fare;
+		double demand;
+	};
+	struct Itinerary {
+		std::vector<int> legs;    // by index in DataRegistry::schLegs
+		int elapsed;              // minutes from the first departure to the last arrival
+	};
+
+	ItineraryGenerator(int maxConnections, int minConnectionTime, int maxConnectionTime);
+
+	// origin,destination,fare,demand with a header line, like the first columns of product.csv
+	void readOdFile(const std::string& filename);
+	void addOd(const OdDemand& od) { ods.push_back(od); }
+
+	// best first, at most maxItineraries (0: all)
+	std::vector<Itinerary> enumerate(const Station* origin, const Station* destination, int maxItineraries) const;
+	// adds the itineraries of all O&Ds as products, returns how many
+	int generate(int maxItineraries, double timeScale, int numThreads);
+
+private:
+	int maxConnections;
+	int minConnectionTime;
+	int maxConnectionTime;
+	std::vector<OdDemand> ods;
+	// station ID -> (departure minute, leg index), by time
+	std::unordered_map<int, std::vector<std::pair<int, int> > > departures;
+
+	void buildIndex();
+	void extend(Itinerary& path, int arrival, const Station* at, const Station* destination,
+		std::vector<const Station*>& visited, std::vector<Itinerary>& found) const;
+};
+
+#endif // !ITINERARY_GENERATOR_H
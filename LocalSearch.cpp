@@ -0,0 +1,510 @@
+#include "LocalSearch.h"
+#include "TS_Model.h"
+#include "DataManager.h"
+#include "FleetBlocks.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <thread>
+#include <tuple>
+
+namespace {
+    const double EPS = 1.0e-6;
+    // cap on the moves collected per station and round
+    const size_t MAX_MOVES_PER_STATION = 20000;
+}
+
+LocalSearch::LocalSearch(const TS_Model& m, const Solution& start, int maxChainLength) :
+    model(m),
+    sol(start),
+    maxChain(std::max(1, maxChainLength)),
+    numFleets(TS_Model::getNumTypeAircrafts()),
+    numMoves(0)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& groundArcs = model.getGroundArcs();
+
+    nodePos.assign(model.getNumNodes(), -1);
+    nodeGround.assign(model.getNumNodes(), -1);
+    nodeStation.assign(model.getNumNodes(), -1);
+    for (const auto& itrMap : model.getStationNodes())
+    {
+        auto& timeline = stationTimeline[itrMap.first];
+        for (const auto node : itrMap.second)
+        {
+            nodePos[node->getID()] = static_cast<int>(timeline.size());
+            nodeGround[node->getID()] = node->leavingGroundArcs.front();
+            nodeStation[node->getID()] = itrMap.first;
+            timeline.push_back(node->getID());
+        }
+    }
+
+    fleetUsage.assign(numFleets, 0.0);
+    for (int i = 0; i < static_cast<int>(flightArcs.size()); i++)
+    {
+        const int k = sol.fleetOf[i];
+        if (k >= 0 && TS_Model::crossesCountLine(flightArcs[i]->getStartTime(), model.getArcHead(i, k)->getTime()))
+            fleetUsage[k] += 1;
+    }
+    for (int g = 0; g < static_cast<int>(groundArcs.size()); g++)
+        if (TS_Model::crossesCountLine(groundArcs[g]->getStartTime(), groundArcs[g]->getEndTime()))
+            for (int k = 0; k < numFleets; k++)
+                fleetUsage[k] += sol.ground[g * numFleets + k];
+
+    const int numLegs = static_cast<int>(dataReg->schLegs.size());
+    legArc.assign(numLegs, -1);
+    legCap.assign(numLegs, 0.0);
+    legLoad.assign(numLegs, 0.0);
+    for (int i = 0; i < static_cast<int>(flightArcs.size()); i++)
+    {
+        if (sol.fleetOf[i] < 0)
+            continue;
+        const int l = TS_Model::getIndex(flightArcs[i]->getLeg());
+        legArc[l] = i;
+        legCap[l] = aircrafts[sol.fleetOf[i]]->getCapacity();
+    }
+    const auto& modelProducts = model.getModelProducts();
+    for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+    {
+        const int p = modelProducts[i];
+        for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+            legLoad[dataReg->productLegs[j]] += sol.satisfied[i];
+    }
+}
+
+/* next[i]: the arc the aircraft of flown arc i continues on, first in first out per station and
+ * fleet; arrivals at a node can leave from the same node. Late arrivals take the first departures
+ * of the day. */
+std::vector<int> LocalSearch::buildRotations() const
+{
+    const auto& flightArcs = model.getFlightArcs();
+    const int numArcs = static_cast<int>(flightArcs.size());
+
+    // (station, fleet) -> (position, 0 for an arrival / 1 for a departure, arc)
+    std::map<std::pair<int, int>, std::vector<std::tuple<int, int, int> > > events;
+    for (int i = 0; i < numArcs; i++)
+    {
+        const int k = sol.fleetOf[i];
+        if (k < 0)
+            continue;
+        const int tail = flightArcs[i]->getTailNode()->getID();
+        const int head = model.getArcHead(i, k)->getID();
+        events[std::make_pair(nodeStation[head], k)].emplace_back(nodePos[head], 0, i);
+        events[std::make_pair(nodeStation[tail], k)].emplace_back(nodePos[tail], 1, i);
+    }
+
+    std::vector<int> next(numArcs, -1);
+    for (auto& itr : events)
+    {
+        auto& ev = itr.second;
+        std::sort(ev.begin(), ev.end());
+        std::deque<int> waiting;
+        std::deque<int> unmatched;
+        for (const auto& e : ev)
+        {
+            if (std::get<1>(e) == 0)
+                waiting.push_back(std::get<2>(e));
+            else if (!waiting.empty())
+            {
+                next[waiting.front()] = std::get<2>(e);
+                waiting.pop_front();
+            }
+            else
+                unmatched.push_back(std::get<2>(e));
+        }
+        while (!waiting.empty() && !unmatched.empty())
+        {
+            next[waiting.front()] = unmatched.front();
+            waiting.pop_front();
+            unmatched.pop_front();
+        }
+    }
+    return next;
+}
+
+void LocalSearch::collectMoves(int station, const std::vector<int>& next, std::vector<Move>& moves) const
+{
+    const auto& flightArcs = model.getFlightArcs();
+
+    struct Chain {
+        int fleet;
+        int endStation;
+        std::vector<int> arcs;
+    };
+    std::vector<Chain> chains;
+    for (int i = 0; i < static_cast<int>(flightArcs.size()); i++)
+    {
+        if (sol.fleetOf[i] < 0 || nodeStation[flightArcs[i]->getTailNode()->getID()] != station)
+            continue;
+        Chain chain{ sol.fleetOf[i], -1, {} };
+        for (int a = i; a >= 0 && static_cast<int>(chain.arcs.size()) < maxChain; a = next[a])
+        {
+            if (!chain.arcs.empty() && a == i)
+                break;
+            chain.arcs.push_back(a);
+            chain.endStation = flightArcs[a]->getArrStation()->getID();
+            chains.push_back(chain);
+        }
+    }
+
+    auto disjoint = [](const std::vector<int>& a, const std::vector<int>& b) -> bool {
+        for (int x : a)
+            if (std::find(b.begin(), b.end(), x) != b.end())
+                return false;
+        return true;
+    };
+
+    for (size_t c = 0; c < chains.size() && moves.size() < MAX_MOVES_PER_STATION; c++)
+    {
+        const auto& first = chains[c];
+        // a chain back to its start station can change fleet alone
+        if (first.endStation == station)
+            for (int k = 0; k < numFleets; k++)
+            {
+                if (k == first.fleet)
+                    continue;
+                Move move;
+                for (int a : first.arcs)
+                    move.arcs.emplace_back(a, k);
+                moves.push_back(move);
+            }
+        // two chains between the same stations exchange their fleets
+        for (size_t d = c + 1; d < chains.size(); d++)
+        {
+            const auto& second = chains[d];
+            if (second.fleet == first.fleet || second.endStation != first.endStation || !disjoint(first.arcs, second.arcs))
+                continue;
+            Move move;
+            for (int a : first.arcs)
+                move.arcs.emplace_back(a, second.fleet);
+            for (int a : second.arcs)
+                move.arcs.emplace_back(a, first.fleet);
+            moves.push_back(move);
+        }
+    }
+}
+
+LocalSearch::MoveResult LocalSearch::evaluate(const Move& move) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& groundArcs = model.getGroundArcs();
+
+    MoveResult result{ false, 0.0, {}, {}, {} };
+    // (fleet, station) -> (timeline position, change of the fleet's net inflow)
+    std::map<std::pair<int, int>, std::vector<std::pair<int, int> > > flowChange;
+    std::vector<double> usageChange(numFleets, 0.0);
+    std::unordered_map<int, double> capChange;
+    double cost = 0;
+
+    for (const auto& change : move.arcs)
+    {
+        const int i = change.first;
+        const int a = sol.fleetOf[i];
+        const int b = change.second;
+        if (a == b)
+            continue;
+        const auto tail = flightArcs[i]->getTailNode();
+        const auto headA = model.getArcHead(i, a);
+        const auto headB = model.getArcHead(i, b);
+        flowChange[std::make_pair(a, nodeStation[tail->getID()])].emplace_back(nodePos[tail->getID()], 1);
+        flowChange[std::make_pair(a, nodeStation[headA->getID()])].emplace_back(nodePos[headA->getID()], -1);
+        flowChange[std::make_pair(b, nodeStation[tail->getID()])].emplace_back(nodePos[tail->getID()], -1);
+        flowChange[std::make_pair(b, nodeStation[headB->getID()])].emplace_back(nodePos[headB->getID()], 1);
+        if (TS_Model::crossesCountLine(tail->getTime(), headA->getTime()))
+            usageChange[a] -= 1;
+        if (TS_Model::crossesCountLine(tail->getTime(), headB->getTime()))
+            usageChange[b] += 1;
+
+        cost += (aircrafts[a]->getCost() - aircrafts[b]->getCost()) * flightArcs[i]->getDuration() / 60.0;
+        capChange[TS_Model::getIndex(flightArcs[i]->getLeg())] += aircrafts[b]->getCapacity() - aircrafts[a]->getCapacity();
+    }
+
+    // ground flows between the first and the last changed node of each station and fleet
+    for (auto& itr : flowChange)
+    {
+        const int k = itr.first.first;
+        const auto& timeline = stationTimeline.at(itr.first.second);
+        auto& changes = itr.second;
+        std::sort(changes.begin(), changes.end());
+        int level = 0;
+        size_t c = 0;
+        for (int pos = changes.front().first; pos < changes.back().first; pos++)
+        {
+            while (c < changes.size() && changes[c].first == pos)
+                level += changes[c++].second;
+            if (level == 0)
+                continue;
+            const int g = nodeGround[timeline[pos]];
+            if (sol.ground[g * numFleets + k] + level < -EPS)
+                return result;
+            result.groundChanges.emplace_back(g * numFleets + k, level);
+            if (TS_Model::crossesCountLine(groundArcs[g]->getStartTime(), groundArcs[g]->getEndTime()))
+                usageChange[k] += level;
+        }
+        while (c < changes.size())
+            level += changes[c++].second;
+        if (level != 0)
+            return result;
+    }
+
+    for (int k = 0; k < numFleets; k++)
+    {
+        if (fleetUsage[k] + usageChange[k] > aircrafts[k]->getNumAircrafts() + EPS)
+            return result;
+        if (usageChange[k] != 0)
+            result.usageChanges.emplace_back(k, usageChange[k]);
+    }
+
+    result.delta = cost + refillProducts(capChange, result);
+    result.feasible = true;
+    return result;
+}
+
+/* Greedy passenger update for changed leg capacities: products on legs that lost seats give them
+ * up cheapest first, then products on legs with free seats take them dearest first. Returns the
+ * revenue change. */
+double LocalSearch::refillProducts(const std::unordered_map<int, double>& capChange, MoveResult& result) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& products = dataReg->products;
+    const auto& modelProducts = model.getModelProducts();
+    const auto& productSlot = model.getProductSlot();
+
+    std::unordered_map<int, double> newSatisfied;
+    std::unordered_map<int, double> loadChange;
+    auto satisfied = [&](int slot) -> double {
+        auto it = newSatisfied.find(slot);
+        return it == newSatisfied.end() ? sol.satisfied[slot] : it->second;
+    };
+    auto residual = [&](int l) -> double {
+        auto itCap = capChange.find(l);
+        auto itLoad = loadChange.find(l);
+        return legCap[l] + (itCap == capChange.end() ? 0.0 : itCap->second)
+            - legLoad[l] - (itLoad == loadChange.end() ? 0.0 : itLoad->second);
+    };
+    auto shift = [&](int slot, double amount) {
+        newSatisfied[slot] = satisfied(slot) + amount;
+        const int p = modelProducts[slot];
+        for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+            loadChange[dataReg->productLegs[j]] += amount;
+    };
+    // in-scope products on leg l, by fare
+    auto legSlots = [&](int l, bool ascending) -> std::vector<int> {
+        std::vector<int> slots;
+        for (int j = dataReg->legProductStart[l]; j < dataReg->legProductStart[l + 1]; j++)
+            if (productSlot[dataReg->legProducts[j]] >= 0)
+                slots.push_back(productSlot[dataReg->legProducts[j]]);
+        std::sort(slots.begin(), slots.end(), [&](int a, int b) -> bool {
+            const double fa = products[modelProducts[a]]->getFare();
+            const double fb = products[modelProducts[b]]->getFare();
+            return ascending ? fa < fb : fa > fb;
+            });
+        return slots;
+    };
+
+    std::vector<int> freed;
+    for (const auto& itr : capChange)
+    {
+        const int l = itr.first;
+        if (itr.second > 0)
+            freed.push_back(l);
+        for (int slot : legSlots(l, true))
+        {
+            if (residual(l) >= -EPS)
+                break;
+            const double cut = std::min(satisfied(slot), std::ceil(-residual(l) - EPS));
+            if (cut <= 0)
+                continue;
+            shift(slot, -cut);
+            const int p = modelProducts[slot];
+            for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+                freed.push_back(dataReg->productLegs[j]);
+        }
+    }
+
+    for (int l : freed)
+        for (int slot : legSlots(l, false))
+        {
+            const int p = modelProducts[slot];
+            double room = products[p]->getDemand() - satisfied(slot);
+            for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+                room = std::min(room, residual(dataReg->productLegs[j]));
+            room = std::floor(room + EPS);
+            if (room >= 1)
+                shift(slot, room);
+        }
+
+    double revenue = 0;
+    for (const auto& itr : newSatisfied)
+    {
+        revenue += products[modelProducts[itr.first]]->getFare() * (itr.second - sol.satisfied[itr.first]);
+        result.satisfiedChanges.emplace_back(itr.first, itr.second);
+    }
+    return revenue;
+}
+
+void LocalSearch::apply(const Move& move, const MoveResult& result)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& modelProducts = model.getModelProducts();
+
+    for (const auto& change : move.arcs)
+    {
+        sol.fleetOf[change.first] = change.second;
+        legCap[TS_Model::getIndex(flightArcs[change.first]->getLeg())] = aircrafts[change.second]->getCapacity();
+    }
+    for (const auto& change : result.groundChanges)
+        sol.ground[change.first] += change.second;
+    for (const auto& change : result.usageChanges)
+        fleetUsage[change.first] += change.second;
+    for (const auto& change : result.satisfiedChanges)
+    {
+        const double amount = change.second - sol.satisfied[change.first];
+        const int p = modelProducts[change.first];
+        for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+            legLoad[dataReg->productLegs[j]] += amount;
+        sol.satisfied[change.first] = change.second;
+    }
+    numMoves++;
+}
+
+double LocalSearch::run(double timeLimit, int numThreads)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    if (numThreads <= 0)
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    std::vector<int> stations;
+    for (const auto& itr : stationTimeline)
+        stations.push_back(itr.first);
+    const int numStations = static_cast<int>(stations.size());
+
+    double gain = 0;
+    while (elapsed() < timeLimit)
+    {
+        const auto next = buildRotations();
+
+        // improving moves of every station, found side by side against the same solution
+        std::vector<std::vector<std::pair<double, Move> > > found(numStations);
+        std::atomic<int> nextStation(0);
+        auto worker = [&]() {
+            std::vector<Move> moves;
+            for (int s = nextStation++; s < numStations; s = nextStation++)
+            {
+                moves.clear();
+                collectMoves(stations[s], next, moves);
+                for (const auto& move : moves)
+                {
+                    const auto result = evaluate(move);
+                    if (result.feasible && result.delta > EPS)
+                        found[s].emplace_back(result.delta, move);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int t = 1; t < std::min(numThreads, numStations); t++)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads)
+            t.join();
+
+        std::vector<std::pair<double, Move> > candidates;
+        for (auto& f : found)
+            for (auto& m : f)
+                candidates.push_back(std::move(m));
+        std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<double, Move>& a,
+            const std::pair<double, Move>& b) -> bool {
+                return a.first > b.first;
+            });
+
+        // apply in order of gain; the rotations are stale once an arc has moved
+        std::vector<char> touched(sol.fleetOf.size(), 0);
+        int applied = 0;
+        for (const auto& cand : candidates)
+        {
+            bool clash = false;
+            for (const auto& change : cand.second.arcs)
+                clash = clash || touched[change.first];
+            if (clash)
+                continue;
+            const auto result = evaluate(cand.second);
+            if (!result.feasible || result.delta <= EPS)
+                continue;
+            apply(cand.second, result);
+            for (const auto& change : cand.second.arcs)
+                touched[change.first] = 1;
+            gain += result.delta;
+            applied++;
+        }
+        if (applied == 0)
+            break;
+    }
+    return gain;
+}
+
+bool LocalSearch::checkSolution(double& profit) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const auto& products = dataReg->products;
+    const auto& modelProducts = model.getModelProducts();
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& groundArcs = model.getGroundArcs();
+    const int numArcs = static_cast<int>(flightArcs.size());
+    const int numGround = static_cast<int>(groundArcs.size());
+
+    profit = 0;
+    for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+        profit += products[modelProducts[i]]->getFare() * sol.satisfied[i];
+
+    return dispatchFleetWidth(numFleets, [&](auto width) -> bool {
+        constexpr int W = decltype(width)::value;
+        FleetArcTable<W> flow(numArcs, numFleets);
+        FleetArcTable<W> cost(numArcs, numFleets);
+        FleetArcTable<W> ground(numGround, numFleets);
+        for (int i = 0; i < numArcs; i++)
+        {
+            if (sol.fleetOf[i] >= 0)
+                flow.at(i, sol.fleetOf[i]) = 1;
+            for (int k = 0; k < numFleets; k++)
+                cost.at(i, k) = -aircrafts[k]->getCost() * flightArcs[i]->getDuration() / 60.0;
+        }
+        for (int g = 0; g < numGround; g++)
+            for (int k = 0; k < numFleets; k++)
+                ground.at(g, k) = sol.ground[g * numFleets + k];
+
+        // inflow - outflow per node; a flight arc carries one fleet, so its row goes to that fleet's head
+        const int nb = flow.getNumBlocks();
+        FleetArcTable<W> balance(model.getNumNodes(), numFleets);
+        for (int i = 0; i < numArcs; i++)
+        {
+            profit += fleetDot(flow.row(i), cost.row(i), nb);
+            if (sol.fleetOf[i] < 0)
+                continue;
+            fleetAxpy(balance.row(flightArcs[i]->getTailNode()->getID()), -1.0, flow.row(i), nb);
+            fleetAxpy(balance.row(model.getArcHead(i, sol.fleetOf[i])->getID()), 1.0, flow.row(i), nb);
+        }
+        for (int g = 0; g < numGround; g++)
+        {
+            fleetAxpy(balance.row(groundArcs[g]->getTailNode()->getID()), -1.0, ground.row(g), nb);
+            fleetAxpy(balance.row(groundArcs[g]->getHeadNode()->getID()), 1.0, ground.row(g), nb);
+        }
+        for (int n = 0; n < model.getNumNodes(); n++)
+            if (fleetMaxAbs(balance.row(n), nb) > EPS)
+                return false;
+        return true;
+    });
+}
@@ -0,0 +1,73 @@
+#ifndef LOCAL_SEARCH_H
+#define LOCAL_SEARCH_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class TS_Model;
+
+/* Improvement phase on a solved fleet assignment. Flown arcs are linked into rotations (first in,
+ * first out at every station and fleet); chains of up to maxChainLength consecutive legs that start
+ * at the same station and end at the same station are exchanged between two fleets, or moved to
+ * another fleet alone. A move is checked against the ground flows of the fleets and stations it
+ * touches and against the fleet counts, and priced incrementally: fleet cost on the changed arcs
+ * plus a greedy refill of the products on the legs whose capacity changed, via the leg/product
+ * incidence. Stations are searched concurrently; improving moves are applied one by one, each
+ * re-evaluated against the current solution. */
+class LocalSearch {
+public:
+	struct Solution {
+		std::vector<int> fleetOf;       // flight arc -> fleet, -1 if not flown
+		std::vector<double> ground;     // [ground arc * numFleets + fleet]
+		std::vector<double> satisfied;  // by position in the model's products
+	};
+
+	LocalSearch(const TS_Model& model, const Solution& start, int maxChainLength);
+
+	// returns the total profit gained
+	double run(double timeLimit, int numThreads);
+	const Solution& getSolution() const { return sol; }
+	int getNumMoves() const { return numMoves; }
+	// flying cost and fares of the current solution, from scratch; false when its flows do not
+	// balance at some node and fleet
+	bool checkSolution(double& profit) const;
+
+private:
+	struct Move {
+		std::vector<std::pair<int, int> > arcs;    // (flight arc, new fleet)
+	};
+	struct MoveResult {
+		bool feasible;
+		double delta;
+		std::vector<std::pair<int, double> > groundChanges;    // (ground arc * numFleets + fleet, change)
+		std::vector<std::pair<int, double> > satisfiedChanges; // (product position, new value)
+		std::vector<std::pair<int, double> > usageChanges;     // (fleet, change)
+	};
+
+	const TS_Model& model;
+	Solution sol;
+	int maxChain;
+	int numFleets;
+	int numMoves;
+
+	// per node: station timeline position and leaving ground arc
+	std::vector<int> nodePos;
+	std::vector<int> nodeGround;
+	std::vector<int> nodeStation;
+	std::unordered_map<int, std::vector<int> > stationTimeline;    // station ID -> node IDs in time order
+	std::vector<double> fleetUsage;
+
+	// legs: global index -> flight arc flown, capacity and load of the current solution
+	std::vector<int> legArc;
+	std::vector<double> legCap;
+	std::vector<double> legLoad;
+
+	std::vector<int> buildRotations() const;
+	void collectMoves(int station, const std::vector<int>& next, std::vector<Move>& moves) const;
+	MoveResult evaluate(const Move& move) const;
+	void apply(const Move& move, const MoveResult& result);
+	double refillProducts(const std::unordered_map<int, double>& capChange, MoveResult& result) const;
+};
+
+#endif // !LOCAL_SEARCH_H
@@ -0,0 +1,72 @@
+#include "ModelCache.h"
+#include "DataManager.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    const std::uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const std::uint64_t FNV_PRIME = 1099511628211ULL;
+    // bump when the formulation or the map layout changes
+    const int CACHE_VERSION = 2;
+}
+
+ModelCache::ModelCache(const std::string& inputDirectory)
+{
+    const auto paramReg = ParamRegistry::instance();
+    // a Benders master has no product half to save
+    if (paramReg->modelCacheDir.empty() || paramReg->useBenders)
+        return;
+    directory = paramReg->modelCacheDir;
+    if (directory.back() != '/' && directory.back() != '\\')
+        directory += '/';
+
+    std::ostringstream params;
+    params << "version=" << CACHE_VERSION << ";timeBucket=" << paramReg->timeBucket << ";countLine=" << paramReg->countLine
+        << ";lazyCapacityRows=" << paramReg->lazyCapacityRows << ";useSsimSchedule=" << paramReg->useSsimSchedule;
+    if (paramReg->useSsimSchedule)
+        params << ";ssimDate=" << paramReg->ssimDate;
+    if (!paramReg->odDemandFile.empty())
+        params << ";maxConnections=" << paramReg->maxConnections << ";minConnectionTime=" << paramReg->minConnectionTime
+            << ";maxConnectionTime=" << paramReg->maxConnectionTime << ";maxItinerariesPerOd=" << paramReg->maxItinerariesPerOd
+            << ";itineraryTimeScale=" << paramReg->itineraryTimeScale;
+    const std::string paramText = params.str();
+
+    std::uint64_t h = hashBytes(FNV_OFFSET, paramText.data(), paramText.size());
+    h = hashFile(h, inputDirectory + "ac.csv");
+    h = hashFile(h, inputDirectory + (paramReg->useSsimSchedule ? paramReg->ssimFile : std::string("schedule.csv")));
+    h = hashFile(h, inputDirectory + "product.csv");
+    if (!paramReg->odDemandFile.empty())
+        h = hashFile(h, inputDirectory + paramReg->odDemandFile);
+
+    char buf[20];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    key = buf;
+}
+
+bool ModelCache::contains() const
+{
+    return enabled() && std::ifstream(modelFile().c_str()).good() && std::ifstream(mapFile().c_str()).good();
+}
+
+std::uint64_t ModelCache::hashBytes(std::uint64_t h, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// a missing file hashes like an empty one, the read that follows reports it
+std::uint64_t ModelCache::hashFile(std::uint64_t h, const std::string& filename)
+{
+    std::ifstream input(filename.c_str(), std::ios::binary);
+    char buf[1 << 16];
+    while (input.read(buf, sizeof(buf)) || input.gcount() > 0)
+        h = hashBytes(h, buf, static_cast<size_t>(input.gcount()));
+    // a separator after every file, so bytes cannot shift from one file to the next
+    return hashBytes(h, "\0", 1);
+}
@@ -0,0 +1,32 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+/* Location of a saved formulation in ParamRegistry::modelCacheDir. The key is an FNV-1a hash of
+ * ac.csv, the schedule input, product.csv, the O&D demand if any and the parameters the
+ * formulation depends on; under it are the model as CPLEX SAV and a map with the names of the
+ * variables and rows in the order TS_Model indexes them (see TS_Model::saveCachedModel). Empty
+ * directory, or useBenders: no cache. */
+class ModelCache {
+public:
+	explicit ModelCache(const std::string& inputDirectory);
+
+	bool enabled() const { return !directory.empty(); }
+	// both files of the key are there
+	bool contains() const;
+
+	const std::string& getKey() const { return key; }
+	std::string modelFile() const { return directory + key + ".sav"; }
+	std::string mapFile() const { return directory + key + ".map"; }
+
+private:
+	std::string directory;
+	std::string key;
+
+	static std::uint64_t hashBytes(std::uint64_t h, const char* data, size_t size);
+	static std::uint64_t hashFile(std::uint64_t h, const std::string& filename);
+};
+
+#endif // !MODEL_CACHE_H
@@ -0,0 +1,308 @@
+#include "MpsWriter.h"
+#include "TS_Model.h"
+#include "DataManager.h"
+#include "FlatNetwork.h"
+#include "TimeUtil.h"
+
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+namespace {
+    const char* const OBJ_ROW = "Profit";
+
+    std::string flightCol(int arc, int k) { return "Flight_" + std::to_string(k) + "_" + std::to_string(arc); }
+    std::string groundCol(int arc, int k) { return "Ground_" + std::to_string(k) + "_" + std::to_string(arc); }
+    std::string productCol(Product* p) { return "Product_" + std::to_string(p->getID()); }
+
+    std::string coverRow(const Leg* leg) { return "FltCover_" + std::to_string(leg->getID()); }
+    std::string capacityRow(const Leg* leg) { return "Capacity_" + std::to_string(leg->getID()); }
+    std::string demandRow(Product* p) { return "Demand_" + std::to_string(p->getID()); }
+    std::string fleetRow(int k) { return "FleetNum_" + std::to_string(k); }
+
+    void entry(std::ostream& out, const std::string& col, const std::string& row, double value)
+    {
+        out << "    " << col << "  " << row << "  " << value << '\n';
+    }
+}
+
+// nodes are numbered by station, then time, the order of the balance rows
+class MpsWriter::Network {
+public:
+    virtual ~Network() {}
+
+    virtual int getNumNodes() const = 0;
+    virtual int getStationID(int node) const = 0;
+    virtual std::string getTime(int node) const = 0;
+
+    virtual int getNumFlightArcs() const = 0;
+    // arcs of the schedule, before any retimed copies
+    virtual int getNumBaseFlightArcs() const = 0;
+    virtual int getLeg(int arc) const = 0;
+    virtual int getTail(int arc) const = 0;
+    virtual int getHead(int arc, int k) const = 0;
+
+    virtual int getNumGroundArcs() const = 0;
+    virtual int getGroundTail(int arc) const = 0;
+    virtual int getGroundHead(int arc) const = 0;
+
+    std::string balanceRow(int node, int k) const
+    {
+        return "Balance_" + std::to_string(getStationID(node)) + "_" + getTime(node) + "_" + std::to_string(k);
+    }
+};
+
+class MpsWriter::ModelNetwork : public MpsWriter::Network {
+public:
+    explicit ModelNetwork(const TS_Model& m) :
+        model(m),
+        position(m.getNumNodes(), -1)
+    {
+        for (const auto& itrMap : model.getStationNodes())
+            for (const auto node : itrMap.second)
+            {
+                position[node->getID()] = static_cast<int>(nodes.size());
+                nodes.push_back(node);
+            }
+    }
+
+    int getNumNodes() const override { return static_cast<int>(nodes.size()); }
+    int getStationID(int node) const override { return nodes[node]->getStation()->getID(); }
+    std::string getTime(int node) const override { return nodes[node]->getTime(); }
+
+    int getNumFlightArcs() const override { return static_cast<int>(model.getFlightArcs().size()); }
+    int getNumBaseFlightArcs() const override { return model.getNumBaseFlightArcs(); }
+    int getLeg(int arc) const override { return TS_Model::getIndex(model.getFlightArcs()[arc]->getLeg()); }
+    int getTail(int arc) const override { return position[model.getFlightArcs()[arc]->getTailNode()->getID()]; }
+    int getHead(int arc, int k) const override { return position[model.getArcHead(arc, k)->getID()]; }
+
+    int getNumGroundArcs() const override { return static_cast<int>(model.getGroundArcs().size()); }
+    int getGroundTail(int arc) const override { return position[model.getGroundArcs()[arc]->getTailNode()->getID()]; }
+    int getGroundHead(int arc) const override { return position[model.getGroundArcs()[arc]->getHeadNode()->getID()]; }
+
+private:
+    const TS_Model& model;
+    std::vector<const TS_Node*> nodes;
+    // node ID -> index above
+    std::vector<int> position;
+};
+
+class MpsWriter::FileNetwork : public MpsWriter::Network {
+public:
+    explicit FileNetwork(const FlatNetwork& n) : network(n) {}
+
+    int getNumNodes() const override { return network.getNumNodes(); }
+    int getStationID(int node) const override { return network.getNode(node).station; }
+    std::string getTime(int node) const override { return toTimeString(network.getNode(node).minute); }
+
+    int getNumFlightArcs() const override { return network.getNumFlightArcs(); }
+    int getNumBaseFlightArcs() const override { return network.getNumFlightArcs(); }
+    int getLeg(int arc) const override { return network.getFlightArc(arc).leg; }
+    int getTail(int arc) const override { return network.getFlightArc(arc).tail; }
+    int getHead(int arc, int k) const override { return network.getArcHead(arc, k); }
+
+    int getNumGroundArcs() const override { return network.getNumGroundArcs(); }
+    int getGroundTail(int arc) const override { return network.getGroundArc(arc).tail; }
+    int getGroundHead(int arc) const override { return network.getGroundArc(arc).head; }
+
+private:
+    const FlatNetwork& network;
+};
+
+MpsWriter::MpsWriter(const TS_Model& model) :
+    network(new ModelNetwork(model)),
+    legFixings(model.getLegFixings())
+{
+    markModelLegs();
+    if (model.isScoped())
+        products = model.getModelProducts();
+    else
+    {
+        products.resize(DataRegistry::instance()->products.size());
+        std::iota(products.begin(), products.end(), 0);
+    }
+}
+
+MpsWriter::MpsWriter(const FlatNetwork& flat, const std::map<unsigned, unsigned>& fixings) :
+    network(new FileNetwork(flat)),
+    legFixings(fixings)
+{
+    markModelLegs();
+    products.resize(DataRegistry::instance()->products.size());
+    std::iota(products.begin(), products.end(), 0);
+}
+
+MpsWriter::~MpsWriter()
+{
+}
+
+void MpsWriter::markModelLegs()
+{
+    modelLeg.assign(DataRegistry::instance()->schLegs.size(), 0);
+    for (int i = 0; i < network->getNumBaseFlightArcs(); i++)
+        modelLeg[network->getLeg(i)] = 1;
+}
+
+void MpsWriter::write(const std::string& filename) const
+{
+    namespace io = boost::iostreams;
+    io::filtering_ostream out;
+    if (boost::algorithm::ends_with(filename, ".gz"))
+        out.push(io::gzip_compressor());
+    out.push(io::file_sink(filename, std::ios::out | std::ios::binary));
+    if (!out.good())
+        throw std::runtime_error("cannot write " + filename);
+    write(out);
+}
+
+void MpsWriter::write(std::ostream& out) const
+{
+    out.precision(15);
+    out << "NAME          AAM\n";
+    out << "OBJSENSE\n    MAX\n";
+    writeRows(out);
+    writeColumns(out);
+    writeRhs(out);
+    writeBounds(out);
+    out << "ENDATA\n";
+}
+
+void MpsWriter::writeRows(std::ostream& out) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& schLegs = dataReg->schLegs;
+    const int numAircraft = TS_Model::getNumTypeAircrafts();
+
+    out << "ROWS\n";
+    out << " N  " << OBJ_ROW << '\n';
+    for (int l = 0; l < static_cast<int>(schLegs.size()); l++)
+        if (modelLeg[l])
+            out << " E  " << coverRow(schLegs[l]) << '\n';
+    for (int k = 0; k < numAircraft; k++)
+        for (int n = 0; n < network->getNumNodes(); n++)
+            out << " E  " << network->balanceRow(n, k) << '\n';
+    for (int k = 0; k < numAircraft; k++)
+        out << " L  " << fleetRow(k) << '\n';
+    for (int l = 0; l < static_cast<int>(schLegs.size()); l++)
+        if (modelLeg[l])
+            out << " G  " << capacityRow(schLegs[l]) << '\n';
+    for (int p : products)
+        out << " L  " << demandRow(dataReg->products[p]) << '\n';
+}
+
+void MpsWriter::writeColumns(std::ostream& out) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const int numAircraft = TS_Model::getNumTypeAircrafts();
+
+    out << "COLUMNS\n";
+    out << "    MARKER  'MARKER'  'INTORG'\n";
+    for (int i = 0; i < network->getNumFlightArcs(); i++)
+    {
+        const auto leg = dataReg->schLegs[network->getLeg(i)];
+        const int tail = network->getTail(i);
+        for (int k = 0; k < numAircraft; k++)
+        {
+            const std::string col = flightCol(i, k);
+            const int head = network->getHead(i, k);
+            const double cost = static_cast<double>(aircrafts[k]->getCost()) * leg->getDuration() / 60;
+            if (cost != 0)
+                entry(out, col, OBJ_ROW, -cost);
+            entry(out, col, coverRow(leg), 1);
+            if (head != tail)
+            {
+                entry(out, col, network->balanceRow(tail, k), -1);
+                entry(out, col, network->balanceRow(head, k), 1);
+            }
+            if (TS_Model::crossesCountLine(network->getTime(tail), network->getTime(head)))
+                entry(out, col, fleetRow(k), 1);
+            entry(out, col, capacityRow(leg), aircrafts[k]->getCapacity());
+        }
+    }
+
+    for (int g = 0; g < network->getNumGroundArcs(); g++)
+    {
+        const int tail = network->getGroundTail(g);
+        const int head = network->getGroundHead(g);
+        const bool crosses = TS_Model::crossesCountLine(network->getTime(tail), network->getTime(head));
+        for (int k = 0; k < numAircraft; k++)
+        {
+            const std::string col = groundCol(g, k);
+            // a station with a single node has a ground arc from the node to itself
+            if (head != tail)
+            {
+                entry(out, col, network->balanceRow(tail, k), -1);
+                entry(out, col, network->balanceRow(head, k), 1);
+            }
+            if (crosses)
+                entry(out, col, fleetRow(k), 1);
+            else if (head == tail)
+                entry(out, col, OBJ_ROW, 0);
+        }
+    }
+
+    for (int p : products)
+    {
+        const auto product = dataReg->products[p];
+        const std::string col = productCol(product);
+        if (product->getFare() != 0)
+            entry(out, col, OBJ_ROW, product->getFare());
+        for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+        {
+            const int l = dataReg->productLegs[j];
+            if (modelLeg[l])
+                entry(out, col, capacityRow(dataReg->schLegs[l]), -1);
+        }
+        entry(out, col, demandRow(product), 1);
+    }
+    out << "    MARKER  'MARKER'  'INTEND'\n";
+}
+
+void MpsWriter::writeRhs(std::ostream& out) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& schLegs = dataReg->schLegs;
+    const auto& aircrafts = dataReg->aircrafts;
+
+    out << "RHS\n";
+    for (int l = 0; l < static_cast<int>(schLegs.size()); l++)
+        if (modelLeg[l])
+            entry(out, "RHS", coverRow(schLegs[l]), 1);
+    for (int k = 0; k < static_cast<int>(aircrafts.size()); k++)
+        if (aircrafts[k]->getNumAircrafts() != 0)
+            entry(out, "RHS", fleetRow(k), aircrafts[k]->getNumAircrafts());
+    for (int p : products)
+        if (dataReg->products[p]->getDemand() != 0)
+            entry(out, "RHS", demandRow(dataReg->products[p]), dataReg->products[p]->getDemand());
+}
+
+// integer columns without bounds read as binaries in some readers, so every column gets its own;
+// legs held by fixLeg close the other fleets
+void MpsWriter::writeBounds(std::ostream& out) const
+{
+    const auto dataReg = DataRegistry::instance();
+    const int numAircraft = TS_Model::getNumTypeAircrafts();
+
+    out << "BOUNDS\n";
+    for (int i = 0; i < network->getNumFlightArcs(); i++)
+    {
+        const auto itFix = legFixings.find(network->getLeg(i));
+        for (int k = 0; k < numAircraft; k++)
+        {
+            if (itFix != legFixings.end() && static_cast<int>(itFix->second) != k)
+                out << " UP BND  " << flightCol(i, k) << "  0\n";
+            else
+                out << " PL BND  " << flightCol(i, k) << '\n';
+        }
+    }
+    for (int g = 0; g < network->getNumGroundArcs(); g++)
+        for (int k = 0; k < numAircraft; k++)
+            out << " PL BND  " << groundCol(g, k) << '\n';
+    for (int p : products)
+        out << " PL BND  " << productCol(dataReg->products[p]) << '\n';
+}
@@ -0,0 +1,52 @@
+#ifndef MPS_WRITER_H
+#define MPS_WRITER_H
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class TS_Model;
+class FlatNetwork;
+
+/* Writes the fleet assignment formulation of a built network as free MPS, straight from the arcs,
+ * the fleets and the products: no Concert objects, and every row and column entry is generated
+ * when it is written, so beyond the network only a flag per leg, the node order and the product
+ * list are kept.
+ * Columns come in the order flight arcs, ground arcs, products; the rows are those of
+ * buildNetworkFormulation and buildProductFormulation, with the capacity and demand rows always
+ * present. A name ending in ".gz" is gzip compressed on the way out. The network is either the
+ * model's or, for schedules too large to hold it, a FlatNetwork on disk with all the legs and
+ * products; both give the same file. */
+class MpsWriter {
+public:
+	explicit MpsWriter(const TS_Model& model);
+	MpsWriter(const FlatNetwork& network, const std::map<unsigned, unsigned>& legFixings);
+	~MpsWriter();
+
+	void write(const std::string& filename) const;
+	void write(std::ostream& out) const;
+
+private:
+	// nodes and arcs by index, whichever network they come from
+	class Network;
+	class ModelNetwork;
+	class FileNetwork;
+
+	std::unique_ptr<Network> network;
+	const std::map<unsigned, unsigned>& legFixings;
+	// legs with a flight arc in the model, i.e. with cover and capacity rows
+	std::vector<char> modelLeg;
+	// products in the model, by index in DataRegistry
+	std::vector<int> products;
+
+	void markModelLegs();
+
+	void writeRows(std::ostream& out) const;
+	void writeColumns(std::ostream& out) const;
+	void writeRhs(std::ostream& out) const;
+	void writeBounds(std::ostream& out) const;
+};
+
+#endif // !MPS_WRITER_H
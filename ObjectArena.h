@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Allocates objects of one type contiguously in fixed-size blocks. Addresses stay stable for the
+// lifetime of the arena; everything is destroyed together when the arena goes away.
+template<class T, size_t BlockSize = 1024>
+class ObjectArena {
+private:
+	struct Slot { alignas(T) unsigned char bytes[sizeof(T)]; };
+
+	std::vector<std::unique_ptr<Slot[]> > blocks;
+	size_t count;
+
+public:
+	ObjectArena() : count(0) {}
+	ObjectArena(const ObjectArena&) = delete;
+	ObjectArena& operator=(const ObjectArena&) = delete;
+	~ObjectArena() { clear(); }
+
+	template<class... Args>
+	T* create(Args&&... args)
+	{
+		if (count == blocks.size() * BlockSize)
+			blocks.emplace_back(new Slot[BlockSize]);
+		void* mem = blocks[count / BlockSize][count % BlockSize].bytes;
+		T* obj = new (mem) T(std::forward<Args>(args)...);
+		++count;
+		return obj;
+	}
+
+	T* at(size_t i) { return std::launder(reinterpret_cast<T*>(blocks[i / BlockSize][i % BlockSize].bytes)); }
+	size_t size() const { return count; }
+
+	void clear()
+	{
+		for (size_t i = 0; i < count; i++)
+			at(i)->~T();
+		blocks.clear();
+		count = 0;
+	}
+};
@@ -0,0 +1,221 @@
+#include "OptimizationService.h"
+#include "DataManager.h"
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace {
+    std::string quote(const std::string& s)
+    {
+        std::string q("\"");
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                q += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                q += c;
+        }
+        return q + "\"";
+    }
+
+    const Aircraft* findFleet(const std::string& tail)
+    {
+        const auto& taiMap = DataRegistry::instance()->_taiMap;
+        auto it = taiMap.find(tail);
+        if (it == taiMap.end())
+            throw std::invalid_argument("unknown fleet " + tail);
+        return it->second;
+    }
+}
+
+OptimizationService::OptimizationService(TS_Model& m) :
+    model(m),
+    solved(false),
+    stopped(false)
+{}
+
+std::string OptimizationService::prepare()
+{
+    const auto start = std::chrono::steady_clock::now();
+    ParamRegistry::instance()->printAlgProcess = false;
+    model.prepare();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::ostringstream reply;
+    reply << "{\"ok\":true,\"cmd\":\"ready\",\"legs\":" << DataRegistry::instance()->schLegs.size()
+        << ",\"products\":" << DataRegistry::instance()->products.size() << ",\"ms\":" << ms << "}";
+    return reply.str();
+}
+
+void OptimizationService::run(std::istream& in, std::ostream& out)
+{
+    std::string line;
+    while (!stopped && std::getline(in, line))
+    {
+        if (line.empty() || line == "\r")
+            continue;
+        out << handle(line) << std::endl;
+    }
+}
+
+std::string OptimizationService::handle(const std::string& request)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::string cmd;
+    std::string body;
+    bool ok = true;
+
+    try
+    {
+        boost::property_tree::ptree req;
+        std::istringstream iss(request);
+        boost::property_tree::read_json(iss, req);
+        cmd = req.get<std::string>("cmd");
+
+        if (cmd == "solve")
+            body = solve();
+        else if (cmd == "setDemand")
+            body = setDemand(req.get<int>("product"), req.get<double>("demand"));
+        else if (cmd == "fixLeg")
+            body = fixLeg(req.get<int>("leg"), req.get<std::string>("fleet"));
+        else if (cmd == "unfixLeg")
+            body = unfixLeg(req.get<int>("leg"));
+        else if (cmd == "query")
+            body = query(req.get<int>("leg", -1));
+        else if (cmd == "stats")
+            body = stats();
+        else if (cmd == "shutdown")
+            stopped = true;
+        else
+            throw std::invalid_argument("unknown command " + cmd);
+    }
+    catch (const IloException& e)
+    {
+        std::ostringstream oss;
+        oss << e;
+        ok = false;
+        body = "\"error\":" + quote(oss.str());
+    }
+    catch (const std::exception& e)
+    {
+        ok = false;
+        body = "\"error\":" + quote(e.what());
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!cmd.empty())
+    {
+        auto& lat = latency.emplace(cmd, LatencyStats{ 0, 0.0, 0.0 }).first->second;
+        lat.count++;
+        lat.totalMs += ms;
+        lat.maxMs = std::max(lat.maxMs, ms);
+    }
+
+    std::ostringstream reply;
+    reply << "{\"ok\":" << (ok ? "true" : "false") << ",\"cmd\":" << quote(cmd);
+    if (!body.empty())
+        reply << "," << body;
+    reply << ",\"ms\":" << ms << "}";
+    return reply.str();
+}
+
+std::string OptimizationService::solve()
+{
+    model.solve();
+    solved = true;
+    if (model.hasFleetShortage())
+        return "\"status\":\"FleetShortage\",\"minFleet\":" + std::to_string(model.getMinFleetSize());
+
+    std::ostringstream oss;
+    oss << model.getCplex().getStatus();
+    std::ostringstream body;
+    body << "\"status\":" << quote(oss.str());
+    if (model.hasSolution())
+        body << ",\"objective\":" << model.getCplex().getObjValue();
+    body << ",\"assigned\":" << model.getAssignment().size() << ",\"solveSeconds\":" << model.getCpuTime();
+    return body.str();
+}
+
+std::string OptimizationService::setDemand(int productID, double demand)
+{
+    if (demand < 0)
+        throw std::invalid_argument("demand must not be negative");
+    const auto& products = DataRegistry::instance()->products;
+    for (int p = 0; p < static_cast<int>(products.size()); p++)
+    {
+        if (products[p]->getID() == productID)
+        {
+            model.setProductDemand(p, demand);
+            return "\"product\":" + std::to_string(productID);
+        }
+    }
+    throw std::invalid_argument("unknown product " + std::to_string(productID));
+}
+
+std::string OptimizationService::fixLeg(int legID, const std::string& tail)
+{
+    const int l = DataRegistry::instance()->getLegIndex(legID);
+    model.fixLeg(l, TS_Model::getIndex(findFleet(tail)));
+    return "\"fixedLegs\":" + std::to_string(model.getLegFixings().size());
+}
+
+std::string OptimizationService::unfixLeg(int legID)
+{
+    model.unfixLeg(DataRegistry::instance()->getLegIndex(legID));
+    return "\"fixedLegs\":" + std::to_string(model.getLegFixings().size());
+}
+
+// assignment of the last solve, for one leg ID or for all legs when legID < 0
+std::string OptimizationService::query(int legID)
+{
+    if (!solved)
+        throw std::logic_error("no solve has run yet");
+
+    const auto dataReg = DataRegistry::instance();
+    const auto& assignment = model.getAssignment();
+    const auto& retimed = model.getRetimedDepartures();
+    std::ostringstream body;
+    if (model.hasSolution())
+        body << "\"objective\":" << model.getCplex().getObjValue() << ",";
+    body << "\"assignment\":[";
+
+    auto first = assignment.begin();
+    auto last = assignment.end();
+    if (legID >= 0)
+    {
+        first = assignment.find(dataReg->getLegIndex(legID));
+        last = first == assignment.end() ? first : std::next(first);
+    }
+    for (auto it = first; it != last; ++it)
+    {
+        const auto leg = dataReg->schLegs[it->first];
+        if (it != first)
+            body << ",";
+        body << "{\"leg\":" << leg->getID() << ",\"flight\":" << quote(leg->getFlightNum())
+            << ",\"fleet\":" << quote(dataReg->aircrafts[it->second]->getTail());
+        auto itRetimed = retimed.find(it->first);
+        if (itRetimed != retimed.end())
+            body << ",\"departure\":" << quote(itRetimed->second);
+        body << "}";
+    }
+    body << "]";
+    return body.str();
+}
+
+std::string OptimizationService::stats() const
+{
+    std::ostringstream body;
+    body << "\"latency\":{";
+    for (auto it = latency.begin(); it != latency.end(); ++it)
+    {
+        if (it != latency.begin())
+            body << ",";
+        body << quote(it->first) << ":{\"count\":" << it->second.count << ",\"meanMs\":"
+            << it->second.totalMs / it->second.count << ",\"maxMs\":" << it->second.maxMs << "}";
+    }
+    body << "}";
+    return body.str();
+}
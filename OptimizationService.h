@@ -0,0 +1,49 @@
+#ifndef OPTIMIZATION_SERVICE_H
+#define OPTIMIZATION_SERVICE_H
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "TS_Model.h"
+
+/* Daemon mode: the input is read and the model built once, then requests are answered from the
+ * resident DataRegistry, network and CPLEX model. Requests and replies are single-line JSON:
+ *   {"cmd":"solve"}
+ *   {"cmd":"setDemand","product":12,"demand":85}
+ *   {"cmd":"fixLeg","leg":1043,"fleet":"A320"}      {"cmd":"unfixLeg","leg":1043}
+ *   {"cmd":"query"}  or  {"cmd":"query","leg":1043}
+ *   {"cmd":"stats"}                                  {"cmd":"shutdown"}
+ * Every reply carries "ok" and the request's latency in milliseconds. Progress printing is turned
+ * off, stdout carries the replies only. */
+class OptimizationService {
+public:
+	explicit OptimizationService(TS_Model& model);
+
+	// builds the network and the formulation, the reply reports the build time
+	std::string prepare();
+	// answers one request per input line until shutdown or end of input
+	void run(std::istream& in, std::ostream& out);
+	std::string handle(const std::string& request);
+
+private:
+	struct LatencyStats {
+		int count;
+		double totalMs;
+		double maxMs;
+	};
+
+	TS_Model& model;
+	bool solved;
+	bool stopped;
+	std::map<std::string, LatencyStats> latency;
+
+	std::string solve();
+	std::string setDemand(int productID, double demand);
+	std::string fixLeg(int legID, const std::string& tail);
+	std::string unfixLeg(int legID);
+	std::string query(int legID);
+	std::string stats() const;
+};
+
+#endif // !OPTIMIZATION_SERVICE_H
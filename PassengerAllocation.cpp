@@ -0,0 +1,205 @@
+#include "PassengerAllocation.h"
+#include "DataManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+ILOSTLBEGIN
+
+namespace {
+    int findRoot(std::vector<int>& parent, int x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void unite(std::vector<int>& parent, int a, int b)
+    {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a != b)
+            parent[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+PassengerAllocation::PassengerAllocation(const std::vector<int>& legs, const std::vector<int>& products, int numWorkers)
+{
+    const auto dataReg = DataRegistry::instance();
+    const int numLegs = static_cast<int>(dataReg->schLegs.size());
+    seatValue.assign(numLegs, 0.0);
+
+    // legs sharing a product are one component; leg-less products go to an extra one
+    std::vector<char> inModel(numLegs, 0);
+    for (int l : legs)
+        inModel[l] = 1;
+    std::vector<int> parent(numLegs + 1);
+    for (int i = 0; i <= numLegs; i++)
+        parent[i] = i;
+    std::vector<int> firstLeg(products.size(), numLegs);
+    for (size_t i = 0; i < products.size(); i++)
+    {
+        const int p = products[i];
+        for (int j = dataReg->productLegStart[p]; j < dataReg->productLegStart[p + 1]; j++)
+        {
+            const int l = dataReg->productLegs[j];
+            if (!inModel[l])
+                continue;
+            if (firstLeg[i] == numLegs)
+                firstLeg[i] = l;
+            else
+                unite(parent, firstLeg[i], l);
+        }
+    }
+
+    std::vector<int> componentOf(numLegs + 1, -1);
+    auto component = [&](int root) -> Component& {
+        if (componentOf[root] < 0)
+        {
+            componentOf[root] = static_cast<int>(components.size());
+            components.push_back(Component{ {}, {}, 0, 0, 0, IloModel(), IloCplex(), IloNumVarArray(), IloRangeArray() });
+        }
+        return components[componentOf[root]];
+    };
+    for (size_t i = 0; i < products.size(); i++)
+    {
+        const auto product = dataReg->products[products[i]];
+        auto& comp = component(findRoot(parent, firstLeg[i]));
+        comp.products.push_back(products[i]);
+        comp.maxRevenue += product->getFare() * product->getDemand();
+    }
+    // legs without products earn nothing and need no LP
+    for (int l : legs)
+    {
+        const int root = findRoot(parent, l);
+        if (componentOf[root] >= 0)
+            components[componentOf[root]].legs.push_back(l);
+    }
+
+    // largest first, each to the least loaded worker
+    if (numWorkers <= 0)
+        numWorkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    numWorkers = std::max(1, std::min(numWorkers, getNumComponents()));
+    std::vector<int> order(components.size());
+    for (size_t c = 0; c < components.size(); c++)
+        order[c] = static_cast<int>(c);
+    std::sort(order.begin(), order.end(), [this](int a, int b) -> bool {
+        return components[a].legs.size() + components[a].products.size() > components[b].legs.size() + components[b].products.size();
+        });
+    std::vector<size_t> load(numWorkers, 0);
+    for (int c : order)
+    {
+        const int w = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        components[c].worker = w;
+        load[w] += components[c].legs.size() + components[c].products.size();
+    }
+
+    for (int w = 0; w < numWorkers; w++)
+        envs.push_back(IloEnv());
+    for (auto& comp : components)
+        buildComponent(comp);
+}
+
+PassengerAllocation::~PassengerAllocation()
+{
+    for (auto& env : envs)
+        env.end();
+}
+
+void PassengerAllocation::buildComponent(Component& comp)
+{
+    const auto dataReg = DataRegistry::instance();
+    IloEnv env = envs[comp.worker];
+    char buf[100];
+
+    comp.model = IloModel(env);
+    comp.carried = IloNumVarArray(env);
+    std::vector<int> slot(dataReg->products.size(), -1);
+    IloExpr obj(env);
+    for (int i = 0; i < static_cast<int>(comp.products.size()); i++)
+    {
+        const auto product = dataReg->products[comp.products[i]];
+        std::sprintf(buf, "Product(%d)", product->getID());
+        comp.carried.add(IloNumVar(env, 0, product->getDemand(), IloNumVar::Float, buf));
+        obj += product->getFare() * comp.carried[i];
+        slot[comp.products[i]] = i;
+    }
+    comp.model.add(IloMaximize(env, obj));
+    obj.end();
+
+    // the rows of TS_Model::addCapacityRow with the seats on the right-hand side
+    comp.capacity = IloRangeArray(env, static_cast<IloInt>(comp.legs.size()));
+    for (int j = 0; j < static_cast<int>(comp.legs.size()); j++)
+    {
+        const int l = comp.legs[j];
+        IloExpr tempExpr(env);
+        for (int p = dataReg->legProductStart[l]; p < dataReg->legProductStart[l + 1]; p++)
+            if (slot[dataReg->legProducts[p]] >= 0)
+                tempExpr += comp.carried[slot[dataReg->legProducts[p]]];
+        std::sprintf(buf, "AircraftCapacity(%s_%d)", dataReg->schLegs[l]->getFlightNum().c_str(), dataReg->schLegs[l]->getID());
+        comp.capacity[j] = IloRange(env, -IloInfinity, tempExpr, 0, buf);
+        tempExpr.end();
+    }
+    comp.model.add(comp.capacity);
+
+    comp.cplex = IloCplex(comp.model);
+    comp.cplex.setOut(env.getNullStream());
+    comp.cplex.setParam(IloCplex::RootAlg, IloCplex::Dual);
+    comp.cplex.setParam(IloCplex::Param::Threads, 1);
+}
+
+bool PassengerAllocation::solveComponent(Component& comp, const std::vector<double>& seats)
+{
+    for (int j = 0; j < static_cast<int>(comp.legs.size()); j++)
+        comp.capacity[j].setUB(seats[comp.legs[j]]);
+    if (!comp.cplex.solve())
+        return false;
+    comp.revenue = comp.cplex.getObjValue();
+    if (comp.legs.empty())
+        return true;
+    IloNumArray duals(comp.cplex.getEnv());
+    comp.cplex.getDuals(duals, comp.capacity);
+    for (int j = 0; j < static_cast<int>(comp.legs.size()); j++)
+        seatValue[comp.legs[j]] = duals[j];
+    duals.end();
+    return true;
+}
+
+bool PassengerAllocation::solve(const std::vector<double>& seats)
+{
+    const int numWorkers = static_cast<int>(envs.size());
+    std::atomic<bool> failed(false);
+    // a worker only touches its own environment and the entries of its components
+    auto worker = [&](int w) {
+        for (auto& comp : components)
+        {
+            if (comp.worker != w)
+                continue;
+            try
+            {
+                if (!solveComponent(comp, seats))
+                {
+                    cerr << "Passenger allocation: " << comp.cplex.getStatus() << endl;
+                    failed = true;
+                }
+            }
+            catch (const IloException& e)
+            {
+                cerr << "Exception caught: " << e << endl;
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int w = 1; w < numWorkers; w++)
+        threads.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : threads)
+        t.join();
+    return !failed;
+}
@@ -0,0 +1,54 @@
+#ifndef PASSENGER_ALLOCATION_H
+#define PASSENGER_ALLOCATION_H
+
+#include <vector>
+#include <ilcplex/ilocplex.h>
+
+/* The passenger side of the fleet assignment as an LP for given seats per leg: the Benders
+ * subproblem of TS_Model::solveBenders. Legs linked by the products over them form a component,
+ * and every component is a separate LP
+ *     max sum fare_p x_p  s.t.  sum_{p over l} x_p <= seats_l,  0 <= x_p <= demand_p,
+ * whose capacity duals price the seats of its legs. Components are dealt to the workers largest
+ * first; a worker keeps its own CPLEX environment and solves only its components, so the LPs of
+ * one round run in parallel and warm start from the previous round. */
+class PassengerAllocation {
+public:
+	// legs and products by index in DataRegistry; products over no leg in `legs` form one
+	// component of their own. 0 workers takes the hardware threads
+	PassengerAllocation(const std::vector<int>& legs, const std::vector<int>& products, int numWorkers);
+	~PassengerAllocation();
+
+	int getNumComponents() const { return static_cast<int>(components.size()); }
+	const std::vector<int>& getLegs(int c) const { return components[c].legs; }
+	// revenue with all the demand carried, a bound on the component's revenue
+	double getMaxRevenue(int c) const { return components[c].maxRevenue; }
+
+	// solves every component for seats[l] seats on leg l (indexed like DataRegistry::schLegs);
+	// false when an LP failed
+	bool solve(const std::vector<double>& seats);
+	double getRevenue(int c) const { return components[c].revenue; }
+	// capacity dual of leg l in the last solve, 0 for legs outside the components
+	double getSeatValue(int l) const { return seatValue[l]; }
+
+private:
+	struct Component {
+		std::vector<int> legs;
+		std::vector<int> products;
+		double maxRevenue;
+		double revenue;
+		int worker;
+		IloModel model;
+		IloCplex cplex;
+		IloNumVarArray carried;
+		IloRangeArray capacity;
+	};
+
+	std::vector<Component> components;
+	std::vector<IloEnv> envs;
+	std::vector<double> seatValue;
+
+	void buildComponent(Component& comp);
+	bool solveComponent(Component& comp, const std::vector<double>& seats);
+};
+
+#endif // !PASSENGER_ALLOCATION_H
@@ -13,7 +13,10 @@ private:
 	double averageDemand;
 	int productID;
 public:
-	std::vector<std::string > fltNums;
+	// flight number IDs interned in DataRegistry::fltNumbers
+	std::vector<int> fltNumIDs;
+	// generated itineraries name their legs by index in DataRegistry::schLegs instead
+	std::vector<int> legIndices;
 
 	Product(Station* ori, Station* des, double f, double d):
 		orign(ori),
@@ -26,11 +29,14 @@ public:
 	Station* getOrigin() { return orign; }
 	Station* getDestination() { return destination; }
 	double getFare() { return fare; }
-	const std::vector<std::string>& getFltNums() const { return fltNums; }
+	const std::vector<int>& getFltNumIDs() const { return fltNumIDs; }
+	const std::vector<int>& getLegIndices() const { return legIndices; }
 	double getDemand() { return averageDemand; }
+	void setDemand(double d) { averageDemand = d; }
 	void setID(int id) { productID = id; }
 	int getID() { return productID; }
 
-	void addFlt(std::string fnum) { fltNums.push_back(fnum); }
+	void addFlt(int fnumID) { fltNumIDs.push_back(fnumID); }
+	void addLeg(int legIndex) { legIndices.push_back(legIndex); }
 
 };
\ No newline at end of file
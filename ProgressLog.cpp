@@ -0,0 +1,121 @@
+#include "ProgressLog.h"
+
+#include <cmath>
+#include <ctime>
+
+namespace {
+    class ProgressCallbackI : public IloCplex::MIPInfoCallbackI {
+    public:
+        ProgressCallbackI(IloEnv env, ProgressLog* l) : IloCplex::MIPInfoCallbackI(env), log(l) {}
+
+        void main() override
+        {
+            const bool incumbent = hasIncumbent();
+            log->record(incumbent, incumbent ? getIncumbentObjValue() : 0.0, getBestObjValue(),
+                incumbent ? getMIPRelativeGap() : 1.0, static_cast<long>(getNnodes()));
+        }
+
+        IloCplex::CallbackI* duplicateCallback() const override
+        {
+            return new (getEnv()) ProgressCallbackI(*this);
+        }
+
+    private:
+        ProgressLog* log;
+    };
+}
+
+ProgressLog::ProgressLog(double i) :
+    interval(i)
+{}
+
+void ProgressLog::begin(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    points.clear();
+    if (output.is_open())
+        output.close();
+    output.open(filename.c_str());
+    output << "time,incumbent,bound,gap,nodes" << std::endl;
+    start = std::chrono::steady_clock::now();
+}
+
+IloCplex::Callback ProgressLog::callback(IloEnv env)
+{
+    return IloCplex::Callback(new (env) ProgressCallbackI(env, this));
+}
+
+void ProgressLog::record(bool hasIncumbent, double incumbent, double bound, double gap, long nodes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!points.empty())
+    {
+        const auto& last = points.back();
+        const bool moved = hasIncumbent != last.hasIncumbent || incumbent != last.incumbent || bound != last.bound;
+        if (!moved && t - last.time < interval)
+            return;
+    }
+    points.push_back({ t, hasIncumbent, incumbent, bound, gap, nodes });
+
+    output << t << ",";
+    if (hasIncumbent)
+        output << incumbent;
+    output << "," << bound << ",";
+    if (hasIncumbent)
+        output << gap;
+    output << "," << nodes << "\n";
+}
+
+void ProgressLog::end()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    output.close();
+}
+
+std::vector<double> ProgressLog::timeToGap(const std::vector<double>& targets) const
+{
+    std::vector<double> times(targets.size(), -1.0);
+    for (size_t i = 0; i < targets.size(); i++)
+        for (const auto& p : points)
+            if (p.hasIncumbent && p.gap <= targets[i])
+            {
+                times[i] = p.time;
+                break;
+            }
+    return times;
+}
+
+void ProgressLog::appendSummary(const std::string& filename, const std::string& runName, const std::vector<double>& targets) const
+{
+    const bool exists = std::ifstream(filename.c_str()).good();
+    std::ofstream summary(filename.c_str(), std::ofstream::app);
+    if (!exists)
+    {
+        summary << "date,run,seconds,final gap,nodes";
+        for (double target : targets)
+            summary << ",t(gap<=" << target << ")";
+        summary << std::endl;
+    }
+
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    summary << date << "," << runName;
+    if (points.empty())
+        summary << ",,,";
+    else
+    {
+        summary << "," << points.back().time << ",";
+        if (points.back().hasIncumbent)
+            summary << points.back().gap;
+        summary << "," << points.back().nodes;
+    }
+    for (double t : timeToGap(targets))
+    {
+        summary << ",";
+        if (t >= 0)
+            summary << t;
+    }
+    summary << std::endl;
+}
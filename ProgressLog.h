@@ -0,0 +1,48 @@
+#ifndef PROGRESS_LOG_H
+#define PROGRESS_LOG_H
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ilcplex/ilocplex.h>
+
+struct ProgressPoint {
+	double time;
+	bool hasIncumbent;
+	double incumbent;
+	double bound;
+	double gap;
+	long nodes;
+};
+
+/* Incumbent and bound trace of a MIP solve. An informational callback records a point whenever the
+ * incumbent or the bound moves, and at most every `interval` seconds otherwise; the points stream
+ * to a CSV file as they come. timeToGap turns the trace into the time each target gap was first
+ * reached, appendSummary adds one such row per solve to a file that collects the runs. */
+class ProgressLog {
+public:
+	explicit ProgressLog(double interval = 1.0);
+
+	// starts the clock and the CSV file; the callback is handed to IloCplex::use
+	void begin(const std::string& filename);
+	IloCplex::Callback callback(IloEnv env);
+	void record(bool hasIncumbent, double incumbent, double bound, double gap, long nodes);
+	void end();
+
+	// seconds until the gap first reached each target, -1 if it never did
+	std::vector<double> timeToGap(const std::vector<double>& targets) const;
+	void appendSummary(const std::string& filename, const std::string& runName, const std::vector<double>& targets) const;
+
+	const std::vector<ProgressPoint>& getPoints() const { return points; }
+
+private:
+	double interval;
+	std::vector<ProgressPoint> points;
+	std::ofstream output;
+	std::mutex mutex;
+	std::chrono::steady_clock::time_point start;
+};
+
+#endif // !PROGRESS_LOG_H
@@ -0,0 +1,174 @@
+#include "RevenueSimulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace {
+    const int SAMPLES_PER_BLOCK = 1024;
+}
+
+unsigned long long RevenueSimulator::blockSeed(unsigned long long seed, unsigned long long block)
+{
+    // splitmix64, so neighbouring blocks get unrelated streams
+    unsigned long long z = seed + (block + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+RevenueSimulator::RevenueSimulator(const std::map<unsigned, unsigned>& assignment, const std::vector<DemandDistribution>& demand)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& legs = dataReg->schLegs;
+    const auto& aircrafts = dataReg->aircrafts;
+    const auto& products = dataReg->products;
+
+    legCapacity.assign(legs.size(), 0.0);
+    for (const auto& it : assignment)
+        legCapacity[it.first] = aircrafts[it.second]->getCapacity();
+
+    std::vector<int> order(products.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&products](int a, int b) -> bool {
+        return products[a]->getFare() > products[b]->getFare();
+        });
+
+    productLegStart.push_back(0);
+    for (int p : order)
+    {
+        fare.push_back(products[p]->getFare());
+        demandMean.push_back(demand[p].mean);
+        demandStd.push_back(demand[p].stdDev);
+        productLegs.insert(productLegs.end(), dataReg->productLegs.begin() + dataReg->productLegStart[p],
+            dataReg->productLegs.begin() + dataReg->productLegStart[p + 1]);
+        productLegStart.push_back(static_cast<int>(productLegs.size()));
+    }
+}
+
+std::vector<DemandDistribution> RevenueSimulator::demandFromProducts(double cv)
+{
+    std::vector<DemandDistribution> demand;
+    for (const auto& product : DataRegistry::instance()->products)
+        demand.push_back({ product->getDemand(), cv * product->getDemand() });
+    return demand;
+}
+
+void RevenueSimulator::simulateBlock(unsigned long long seed, int count, double* out) const
+{
+    const int numLegs = static_cast<int>(legCapacity.size());
+    const int numProducts = static_cast<int>(fare.size());
+
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    // remaining seats, one row of LANES samples per leg
+    std::vector<double> remCap(static_cast<size_t>(numLegs) * LANES);
+    alignas(64) double seats[LANES];
+    alignas(64) double revenue[LANES];
+
+    for (int s = 0; s < count; s += LANES)
+    {
+        for (int l = 0; l < numLegs; l++)
+            for (int lane = 0; lane < LANES; lane++)
+                remCap[l * LANES + lane] = legCapacity[l];
+        for (int lane = 0; lane < LANES; lane++)
+            revenue[lane] = 0.0;
+
+        for (int p = 0; p < numProducts; p++)
+        {
+            for (int lane = 0; lane < LANES; lane++)
+                seats[lane] = std::max(0.0, std::floor(demandMean[p] + demandStd[p] * normal(rng) + 0.5));
+
+            const int first = productLegStart[p];
+            const int last = productLegStart[p + 1];
+            for (int i = first; i < last; i++)
+            {
+                const double* cap = &remCap[productLegs[i] * LANES];
+                for (int lane = 0; lane < LANES; lane++)
+                    seats[lane] = std::min(seats[lane], cap[lane]);
+            }
+            for (int i = first; i < last; i++)
+            {
+                double* cap = &remCap[productLegs[i] * LANES];
+                for (int lane = 0; lane < LANES; lane++)
+                    cap[lane] -= seats[lane];
+            }
+            for (int lane = 0; lane < LANES; lane++)
+                revenue[lane] += fare[p] * seats[lane];
+        }
+
+        for (int lane = 0; lane < LANES && s + lane < count; lane++)
+            out[s + lane] = revenue[lane];
+    }
+}
+
+RevenueStats RevenueSimulator::run(int numSamples, unsigned long long seed, int numThreads)
+{
+    samples.assign(numSamples, 0.0);
+    const int numBlocks = (numSamples + SAMPLES_PER_BLOCK - 1) / SAMPLES_PER_BLOCK;
+    if (numThreads <= 0)
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    numThreads = std::min(numThreads, std::max(1, numBlocks));
+
+    // blocks are seeded by index, so results do not depend on the number of threads
+    std::atomic<int> nextBlock(0);
+    auto worker = [&]() {
+        for (int b = nextBlock++; b < numBlocks; b = nextBlock++)
+        {
+            const int first = b * SAMPLES_PER_BLOCK;
+            const int count = std::min(SAMPLES_PER_BLOCK, numSamples - first);
+            simulateBlock(blockSeed(seed, b), count, &samples[first]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    RevenueStats stats = { numSamples, 0, 0, 0, 0, 0, 0, 0 };
+    if (numSamples == 0)
+        return stats;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double q) -> double {
+        return sorted[static_cast<size_t>(q * (sorted.size() - 1) + 0.5)];
+    };
+
+    const double sum = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+    stats.mean = sum / numSamples;
+    double sq = 0;
+    for (double v : sorted)
+        sq += (v - stats.mean) * (v - stats.mean);
+    stats.stdDev = numSamples > 1 ? std::sqrt(sq / (numSamples - 1)) : 0.0;
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.p5 = percentile(0.05);
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    return stats;
+}
+
+void RevenueSimulator::writeReport(const std::string& filename, const RevenueStats& stats) const
+{
+    std::ofstream output;
+    output.open(filename.c_str());
+
+    output << "Samples:\t" << stats.numSamples << std::endl;
+    output << "Mean revenue:\t" << stats.mean << std::endl;
+    output << "Std deviation:\t" << stats.stdDev << std::endl;
+    output << "Min:\t" << stats.min << std::endl;
+    output << "P5:\t" << stats.p5 << std::endl;
+    output << "P50:\t" << stats.p50 << std::endl;
+    output << "P95:\t" << stats.p95 << std::endl;
+    output << "Max:\t" << stats.max << std::endl;
+
+    output.close();
+}
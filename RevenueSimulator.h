@@ -0,0 +1,61 @@
+#ifndef REVENUE_SIMULATOR_H
+#define REVENUE_SIMULATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DataManager.h"
+
+struct DemandDistribution {
+	double mean;
+	double stdDev;
+};
+
+struct RevenueStats {
+	int numSamples;
+	double mean;
+	double stdDev;
+	double min;
+	double max;
+	double p5;
+	double p50;
+	double p95;
+};
+
+/* Monte Carlo evaluation of a fixed fleet assignment under demand uncertainty.
+ * Every sample draws one demand per product and fills the legs' seats greedily by fare; the
+ * kernel runs LANES samples side by side so that the per-leg capacity updates vectorize. */
+class RevenueSimulator {
+public:
+	static const int LANES = 8;
+
+	// assignment: leg index -> fleet index, as produced by TS_Model::updateSolution
+	RevenueSimulator(const std::map<unsigned, unsigned>& assignment, const std::vector<DemandDistribution>& demand);
+
+	// every product gets a normal demand around its average with the given coefficient of variation
+	static std::vector<DemandDistribution> demandFromProducts(double cv);
+	// seed of a block of samples, so results do not depend on the number of threads
+	static unsigned long long blockSeed(unsigned long long seed, unsigned long long block);
+
+	RevenueStats run(int numSamples, unsigned long long seed, int numThreads = 0);
+	void writeReport(const std::string& filename, const RevenueStats& stats) const;
+
+	const std::vector<double>& getSamples() const { return samples; }
+
+private:
+	std::vector<double> legCapacity;
+
+	// products in descending fare order, with their legs in CSR form
+	std::vector<double> fare;
+	std::vector<double> demandMean;
+	std::vector<double> demandStd;
+	std::vector<int> productLegStart;
+	std::vector<int> productLegs;
+
+	std::vector<double> samples;
+
+	void simulateBlock(unsigned long long seed, int count, double* out) const;
+};
+
+#endif // !REVENUE_SIMULATOR_H
@@ -0,0 +1,87 @@
+#include "SolverGuidance.h"
+#include "TS_Model.h"
+#include "DataManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace {
+    // flight arcs spread over [MIN, MAX] by score, above the hub ground arcs and everything else (0)
+    const int MIN_FLIGHT_PRIORITY = 10;
+    const int MAX_FLIGHT_PRIORITY = 100;
+    const int HUB_GROUND_PRIORITY = 5;
+}
+
+SolverGuidance::SolverGuidance(const TS_Model& model) :
+    numHubs(0)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& products = dataReg->products;
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& groundArcs = model.getGroundArcs();
+    const auto& legFixings = model.getLegFixings();
+    const auto& productSlot = model.getProductSlot();
+    const int numFleets = TS_Model::getNumTypeAircrafts();
+    const int numArcs = static_cast<int>(flightArcs.size());
+
+    // revenue of the products in the model over every leg, at full demand
+    std::vector<double> legRevenue(dataReg->schLegs.size(), 0.0);
+    for (int l = 0; l < static_cast<int>(dataReg->schLegs.size()); l++)
+        for (int j = dataReg->legProductStart[l]; j < dataReg->legProductStart[l + 1]; j++)
+        {
+            const int p = dataReg->legProducts[j];
+            if (productSlot.empty() || productSlot[p] >= 0)
+                legRevenue[l] += products[p]->getFare() * products[p]->getDemand();
+        }
+
+    double maxDuration = 0;
+    double maxRevenue = 0;
+    for (const auto pArc : flightArcs)
+    {
+        maxDuration = std::max(maxDuration, static_cast<double>(pArc->getDuration()));
+        maxRevenue = std::max(maxRevenue, legRevenue[TS_Model::getIndex(pArc->getLeg())]);
+    }
+    flightPriority.assign(numArcs, MIN_FLIGHT_PRIORITY);
+    for (int i = 0; i < numArcs; i++)
+    {
+        const double duration = maxDuration > 0 ? flightArcs[i]->getDuration() / maxDuration : 0.0;
+        const double revenue = maxRevenue > 0 ? legRevenue[TS_Model::getIndex(flightArcs[i]->getLeg())] / maxRevenue : 0.0;
+        flightPriority[i] += static_cast<int>(std::lround(0.5 * (duration + revenue) * (MAX_FLIGHT_PRIORITY - MIN_FLIGHT_PRIORITY)));
+    }
+
+    // departures per station, and the fleets with an open flight arc leaving or reaching it
+    std::map<int, int> departures;
+    std::set<std::pair<int, int> > served;
+    for (int i = 0; i < numArcs; i++)
+    {
+        const int tail = flightArcs[i]->getTailNode()->getStation()->getID();
+        if (i < model.getNumBaseFlightArcs())
+            departures[tail]++;
+        auto itFix = legFixings.find(TS_Model::getIndex(flightArcs[i]->getLeg()));
+        for (int k = 0; k < numFleets; k++)
+            if (itFix == legFixings.end() || static_cast<int>(itFix->second) == k)
+            {
+                served.emplace(tail, k);
+                served.emplace(model.getArcHead(i, k)->getStation()->getID(), k);
+            }
+    }
+    std::set<int> hubs;
+    const double hubDepartures = ParamRegistry::instance()->guidanceHubShare * model.getNumBaseFlightArcs();
+    for (const auto& it : departures)
+        if (it.second > 0 && it.second >= hubDepartures)
+            hubs.insert(it.first);
+    numHubs = static_cast<int>(hubs.size());
+
+    groundPriority.assign(groundArcs.size(), 0);
+    for (int g = 0; g < static_cast<int>(groundArcs.size()); g++)
+    {
+        const int station = groundArcs[g]->getTailNode()->getStation()->getID();
+        if (hubs.count(station))
+            groundPriority[g] = HUB_GROUND_PRIORITY;
+        for (int k = 0; k < numFleets; k++)
+            if (!served.count(std::make_pair(station, k)))
+                groundFixes.emplace_back(g, k);
+    }
+}
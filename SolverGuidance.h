@@ -0,0 +1,34 @@
+#ifndef SOLVER_GUIDANCE_H
+#define SOLVER_GUIDANCE_H
+
+#include <utility>
+#include <vector>
+
+class TS_Model;
+
+/* Branching priorities and variable fixes for the MIP, from the network alone. Flight arcs rank
+ * by block time and by the revenue of the products over their leg, both relative to the largest,
+ * so long-haul and high-revenue assignments are branched on first; ground arcs at hubs (stations
+ * with at least guidanceHubShare of the departures) come next, everything else after them.
+ * A fleet that has no open flight arc at a station can only park idle aircraft there: its ground
+ * arcs carry one constant flow that costs nothing and only uses up the fleet count, so they are
+ * zero in some optimal solution and get fixed to zero. */
+class SolverGuidance {
+public:
+	explicit SolverGuidance(const TS_Model& model);
+
+	// by position in the model's flight / ground arcs, 0 for no priority
+	const std::vector<int>& getFlightPriorities() const { return flightPriority; }
+	const std::vector<int>& getGroundPriorities() const { return groundPriority; }
+	// (ground arc, fleet) to fix to zero
+	const std::vector<std::pair<int, int> >& getGroundFixes() const { return groundFixes; }
+	int getNumHubs() const { return numHubs; }
+
+private:
+	std::vector<int> flightPriority;
+	std::vector<int> groundPriority;
+	std::vector<std::pair<int, int> > groundFixes;
+	int numHubs;
+};
+
+#endif // !SOLVER_GUIDANCE_H
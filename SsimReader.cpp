@@ -0,0 +1,271 @@
+#include "SsimReader.h"
+#include "DataManager.h"
+#include "TimeUtil.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+    const int SSIM_RECORD_LENGTH = 200;
+    const int UNTIL_FURTHER_NOTICE = 0x7fffffff;
+
+    // 1-based SSIM column, blank past the end of a trimmed record
+    inline char col(const char* line, int len, int c) { return c <= len ? line[c - 1] : ' '; }
+
+    int number(const char* line, int len, int c, int width)
+    {
+        int v = 0;
+        for (int i = 0; i < width; i++)
+        {
+            const char ch = col(line, len, c + i);
+            if (ch < '0' || ch > '9')
+                return -1;
+            v = v * 10 + (ch - '0');
+        }
+        return v;
+    }
+
+    // HHMM -> minutes after midnight
+    int hhmm(const char* line, int len, int c)
+    {
+        const int v = number(line, len, c, 4);
+        return v < 0 ? -1 : (v / 100) * 60 + v % 100;
+    }
+
+    // +HHMM / -HHMM -> minutes
+    int utcVariation(const char* line, int len, int c)
+    {
+        const int v = hhmm(line, len, c + 1);
+        if (v < 0)
+            return 0;
+        return col(line, len, c) == '-' ? -v : v;
+    }
+
+    // date variation: blank/0..9 days later, A one day earlier
+    int dateVariation(char ch)
+    {
+        if (ch == 'A')
+            return -1;
+        return (ch >= '0' && ch <= '9') ? ch - '0' : 0;
+    }
+
+    int daysFromCivil(int y, int m, int d)
+    {
+        y -= m <= 2;
+        const int era = (y >= 0 ? y : y - 399) / 400;
+        const int yoe = y - era * 400;
+        const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    // 1 = Monday ... 7 = Sunday, as in the days of operation field
+    inline int weekday(int day) { return ((day + 3) % 7 + 7) % 7 + 1; }
+}
+
+SsimReader::SsimReader(int threads, size_t blockBytes) :
+    numThreads(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))),
+    blockSize(std::max<size_t>(blockBytes, 4 * (SSIM_RECORD_LENGTH + 2))),
+    planningDay(-1),
+    nextLegID(1)
+{}
+
+int SsimReader::parseDate(const char* p)
+{
+    static const char* months = "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC";
+    if (std::strncmp(p, "00XXX00", 7) == 0)
+        return UNTIL_FURTHER_NOTICE;
+    const int day = number(p, 7, 1, 2);
+    const int year = number(p, 7, 6, 2);
+    int month = 0;
+    for (int m = 0; m < 12; m++)
+        if (std::strncmp(p + 2, months + 3 * m, 3) == 0)
+            month = m + 1;
+    if (day < 1 || year < 0 || month == 0)
+        return -1;
+    return daysFromCivil(2000 + year, month, day);
+}
+
+bool SsimReader::parseLeg(const char* line, int len, LegRecord& rec) const
+{
+    if (len < 75 || line[0] != '3')
+        return false;
+
+    // period and days of operation refer to the itinerary date, the leg may depart days later
+    const int depVar = dateVariation(col(line, len, 193));
+    const int arrVar = dateVariation(col(line, len, 194));
+    const int day = planningDay - depVar;
+
+    const int from = parseDate(line + 14);
+    const int to = parseDate(line + 21);
+    if (from < 0 || to < 0 || day < from || day > to)
+        return false;
+    if (col(line, len, 28 + weekday(day)) == ' ')
+        return false;
+    if (col(line, len, 36) == '2' && ((day - from) / 7) % 2 != 0)
+        return false;
+
+    rec.line = line;
+    rec.depMinute = hhmm(line, len, 44);
+    rec.arrMinute = hhmm(line, len, 58);
+    if (rec.depMinute < 0 || rec.arrMinute < 0)
+        return false;
+    rec.duration = (rec.arrMinute - utcVariation(line, len, 66)) - (rec.depMinute - utcVariation(line, len, 48))
+        + 1440 * (arrVar - depVar);
+    rec.serial = number(line, len, 195, 6);
+    return true;
+}
+
+void SsimReader::scanChunk(const char* begin, const char* end, std::vector<LegRecord>& out) const
+{
+    LegRecord rec;
+    while (begin < end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!eol)
+            eol = end;
+        int len = static_cast<int>(eol - begin);
+        if (len > 0 && begin[len - 1] == '\r')
+            len--;
+        if (parseLeg(begin, len, rec))
+            out.push_back(rec);
+        begin = eol + 1;
+    }
+}
+
+void SsimReader::findPlanningDay(const char* begin, const char* end)
+{
+    while (begin < end && planningDay < 0)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!eol)
+            eol = end;
+        // carrier record: period of schedule validity from, columns 15-21
+        if (*begin == '2' && eol - begin >= 21)
+            planningDay = parseDate(begin + 14);
+        begin = eol + 1;
+    }
+}
+
+int SsimReader::emit(const std::vector<LegRecord>& records)
+{
+    auto dataReg = DataRegistry::instance();
+    char fltNum[16];
+    char code[4] = { 0, 0, 0, 0 };
+
+    for (const auto& rec : records)
+    {
+        // airline designator + flight number without padding, plus the operational suffix
+        int n = 0;
+        for (int c = 3; c <= 5; c++)
+            if (rec.line[c - 1] != ' ')
+                fltNum[n++] = rec.line[c - 1];
+        int c = 6;
+        while (c < 9 && (rec.line[c - 1] == '0' || rec.line[c - 1] == ' '))
+            c++;
+        for (; c <= 9; c++)
+            fltNum[n++] = rec.line[c - 1];
+        if (rec.line[1] != ' ')
+            fltNum[n++] = rec.line[1];
+        fltNum[n] = 0;
+
+        std::memcpy(code, rec.line + 36, 3);
+        auto pDepStn = dataReg->getOrCreateStation(code);
+        std::memcpy(code, rec.line + 54, 3);
+        auto pArrStn = dataReg->getOrCreateStation(code);
+
+        const int legID = rec.serial > 0 ? rec.serial : nextLegID;
+        nextLegID = std::max(nextLegID, legID) + 1;
+        dataReg->createLeg(fltNum, toTimeString(rec.depMinute), toTimeString(rec.arrMinute), pDepStn, pArrStn,
+            rec.duration, legID);
+    }
+    return static_cast<int>(records.size());
+}
+
+int SsimReader::read(const std::string& filename, const std::string& date)
+{
+    std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
+    if (!ifs.is_open())
+    {
+        std::cerr << "Cannot open SSIM file " << filename << std::endl;
+        return 0;
+    }
+
+    planningDay = date.size() >= 7 ? parseDate(date.c_str()) : -1;
+    if (!date.empty() && planningDay < 0)
+    {
+        std::cerr << "Invalid SSIM planning date " << date << std::endl;
+        return 0;
+    }
+
+    std::vector<char> buffer(blockSize);
+    std::vector<std::vector<LegRecord> > parts(numThreads);
+    size_t carry = 0;
+    int numLegs = 0;
+
+    while (true)
+    {
+        ifs.read(buffer.data() + carry, buffer.size() - carry);
+        const size_t filled = carry + static_cast<size_t>(ifs.gcount());
+        if (filled == 0)
+            break;
+
+        // process whole records only, the tail is carried into the next block
+        const char* data = buffer.data();
+        size_t usable = filled;
+        if (!ifs.eof())
+        {
+            const char* lastEol = data + filled;
+            while (lastEol > data && lastEol[-1] != '\n')
+                lastEol--;
+            usable = static_cast<size_t>(lastEol - data);
+            if (usable == 0)
+            {
+                std::cerr << "SSIM record longer than the read block in " << filename << std::endl;
+                break;
+            }
+        }
+
+        if (planningDay < 0)
+            findPlanningDay(data, data + usable);
+
+        // split at record boundaries and scan the pieces concurrently
+        std::vector<const char*> bounds(numThreads + 1, data + usable);
+        bounds[0] = data;
+        for (int t = 1; t < numThreads; t++)
+        {
+            const char* p = std::max(bounds[t - 1], data + usable * t / numThreads);
+            while (p < data + usable && p > data && p[-1] != '\n')
+                p++;
+            bounds[t] = p;
+        }
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; t++)
+        {
+            parts[t].clear();
+            if (t == 0)
+                continue;
+            threads.emplace_back(&SsimReader::scanChunk, this, bounds[t], bounds[t + 1], std::ref(parts[t]));
+        }
+        scanChunk(bounds[0], bounds[1], parts[0]);
+        for (auto& th : threads)
+            th.join();
+
+        // legs are created in file order
+        for (const auto& part : parts)
+            numLegs += emit(part);
+
+        carry = filled - usable;
+        std::memmove(buffer.data(), data + usable, carry);
+        if (ifs.eof())
+            break;
+    }
+
+    ifs.close();
+    if (planningDay < 0)
+        std::cerr << "No planning date and no carrier record in " << filename << std::endl;
+    return numLegs;
+}
@@ -0,0 +1,42 @@
+#ifndef SSIM_READER_H
+#define SSIM_READER_H
+
+#include <string>
+#include <vector>
+
+/* Streaming reader for IATA SSIM Chapter 7 schedule files. The file is read in large blocks;
+ * every block is split at record boundaries and scanned in parallel, and the flight leg records
+ * (type 3) that operate on the planning date are handed to DataRegistry as legs. Fields are read
+ * in place from the block, only the legs that are kept allocate strings. */
+class SsimReader {
+public:
+	explicit SsimReader(int threads = 0, size_t blockBytes = 64 << 20);
+
+	// date is DDMMMYY; an empty date takes the first day of the carrier record's validity period.
+	// Returns the number of legs added.
+	int read(const std::string& filename, const std::string& date);
+
+	// days since 1970-01-01 for a DDMMMYY field, -1 if malformed
+	static int parseDate(const char* p);
+
+private:
+	struct LegRecord {
+		const char* line;
+		int depMinute;
+		int arrMinute;
+		int duration;
+		int serial;
+	};
+
+	int numThreads;
+	size_t blockSize;
+	int planningDay;
+	int nextLegID;
+
+	void scanChunk(const char* begin, const char* end, std::vector<LegRecord>& out) const;
+	bool parseLeg(const char* line, int len, LegRecord& rec) const;
+	void findPlanningDay(const char* begin, const char* end);
+	int emit(const std::vector<LegRecord>& records);
+};
+
+#endif // !SSIM_READER_H
@@ -22,9 +22,9 @@ public:
 	std::string& getCode() { return code; }
 	int getID() const { return staID; }
 	
-	//Ϊʲôسã
-	std::vector<Leg*> getDepLegs() const { return depLegs; }
-	std::vector<Leg*> getArrLegs() const { return arrLegs; }
+	// filled by DataRegistry::createLeg, in schedule order
+	const std::vector<Leg*>& getDepLegs() const { return depLegs; }
+	const std::vector<Leg*>& getArrLegs() const { return arrLegs; }
 
 	void addDepLeg(Leg* l) { depLegs.push_back(l); }
 	void addArrLeg(Leg* l) { arrLegs.push_back(l); }
@@ -0,0 +1,228 @@
+#include "StrategyPlanner.h"
+#include "TS_Model.h"
+#include "DataManager.h"
+
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include "boost/algorithm/string.hpp"
+
+namespace {
+    // defaults before any run is recorded: seconds at 1e5 nonzeros and the exponent
+    const double DEFAULT_SECONDS[] = { 10.0, 8.0, 3.0, 1.0 };
+    const double DEFAULT_EXPONENT[] = { 1.5, 1.3, 1.2, 1.0 };
+    // share of the nonzeros in the passenger part from which Benders is considered
+    const double BENDERS_PRODUCT_SHARE = 0.5;
+}
+
+StrategyPlanner::StrategyPlanner(const TS_Model& model) :
+    budget(0),
+    strategy(HEURISTIC)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& flightArcs = model.getFlightArcs();
+    const auto& groundArcs = model.getGroundArcs();
+    const double numFleets = TS_Model::getNumTypeAircrafts();
+    const double numLegs = model.getNumBaseFlightArcs();
+    const double numProducts = static_cast<double>(dataReg->products.size());
+
+    // FlightCover and AircraftCapacity per leg, NetworkBalance per node and fleet, FleetNum,
+    // ProductDemand; columns per arc and fleet and per product
+    estimate.rows = 2 * numLegs + model.getNumNodes() * numFleets + numFleets + numProducts;
+    estimate.columns = (flightArcs.size() + groundArcs.size()) * numFleets + numProducts;
+
+    double network = 0;
+    for (int i = 0; i < static_cast<int>(flightArcs.size()); i++)
+        for (int k = 0; k < static_cast<int>(numFleets); k++)
+        {
+            const auto head = model.getArcHead(i, k);
+            network += 2 + (head != flightArcs[i]->getTailNode() ? 2 : 0)
+                + (TS_Model::crossesCountLine(flightArcs[i]->getStartTime(), head->getTime()) ? 1 : 0);
+        }
+    for (const auto pArc : groundArcs)
+        network += numFleets * ((pArc->getHeadNode() != pArc->getTailNode() ? 2 : 0)
+            + (TS_Model::crossesCountLine(pArc->getStartTime(), pArc->getEndTime()) ? 1 : 0));
+    estimate.productNonzeros = static_cast<double>(dataReg->productLegs.size()) + numProducts;
+    estimate.nonzeros = network + estimate.productNonzeros;
+}
+
+const char* StrategyPlanner::getName(Strategy s)
+{
+    static const char* const names[] = { "exact_mip", "benders", "lp_diving", "heuristic" };
+    return names[s];
+}
+
+/* History rows are date,run,strategy,rows,columns,nonzeros,budget,seconds,gap. A run that used its
+ * whole budget only says the strategy takes longer, so only the finished ones are fitted. */
+void StrategyPlanner::calibrate(const std::string& historyFile)
+{
+    std::vector<std::vector<std::pair<double, double> > > samples(NUM_STRATEGIES);
+    std::ifstream input(historyFile.c_str());
+    std::string line;
+    std::getline(input, line);
+    while (std::getline(input, line))
+    {
+        std::vector<std::string> vals;
+        boost::split(vals, line, boost::is_any_of(","));
+        if (vals.size() < 8)
+            continue;
+        int s = 0;
+        while (s < NUM_STRATEGIES && vals[2] != getName(static_cast<Strategy>(s)))
+            s++;
+        try
+        {
+            const double nonzeros = std::stod(vals[5]);
+            const double runBudget = std::stod(vals[6]);
+            const double seconds = std::stod(vals[7]);
+            if (s < NUM_STRATEGIES && nonzeros > 0 && seconds > 0 && seconds < 0.95 * runBudget)
+                samples[s].emplace_back(std::log(nonzeros), std::log(seconds));
+        }
+        catch (const std::exception&)
+        {
+            // a damaged row is skipped
+        }
+    }
+
+    fits.clear();
+    for (int s = 0; s < NUM_STRATEGIES; s++)
+    {
+        Fit fit = { std::log(DEFAULT_SECONDS[s]) - DEFAULT_EXPONENT[s] * std::log(1.0e5), DEFAULT_EXPONENT[s],
+            static_cast<int>(samples[s].size()) };
+        const double n = static_cast<double>(samples[s].size());
+        if (n > 0)
+        {
+            double mx = 0, my = 0;
+            for (const auto& xy : samples[s])
+            {
+                mx += xy.first / n;
+                my += xy.second / n;
+            }
+            double sxx = 0, sxy = 0;
+            for (const auto& xy : samples[s])
+            {
+                sxx += (xy.first - mx) * (xy.first - mx);
+                sxy += (xy.first - mx) * (xy.second - my);
+            }
+            // sizes within about 10% of each other cannot tell the exponent
+            if (n >= 3 && sxx / n > 0.01)
+                fit.b = std::min(3.0, std::max(0.5, sxy / sxx));
+            fit.a = my - fit.b * mx;
+        }
+        fits.push_back(fit);
+    }
+}
+
+double StrategyPlanner::predict(Strategy s) const
+{
+    return std::exp(fits[s].a + fits[s].b * std::log(std::max(1.0, estimate.nonzeros)));
+}
+
+StrategyPlanner::Strategy StrategyPlanner::choose(double b)
+{
+    const auto paramReg = ParamRegistry::instance();
+    budget = b;
+    calibrate(paramReg->strategyHistory);
+    predicted.clear();
+    for (int s = 0; s < NUM_STRATEGIES; s++)
+        predicted.push_back(predict(static_cast<Strategy>(s)));
+
+    const double limit = paramReg->strategySafety * budget;
+    const double productShare = estimate.productNonzeros / std::max(1.0, estimate.nonzeros);
+    reasons.clear();
+    auto fitsBudget = [&](Strategy s) -> bool {
+        const bool fits = predicted[s] <= limit;
+        std::ostringstream reason;
+        reason << getName(s) << ": " << predicted[s] << "s predicted, " << (fits ? "within " : "over ") << limit << "s";
+        reasons.push_back(reason.str());
+        return fits;
+    };
+
+    if (fitsBudget(EXACT_MIP))
+        strategy = EXACT_MIP;
+    else if (productShare < BENDERS_PRODUCT_SHARE)
+    {
+        std::ostringstream reason;
+        reason << getName(BENDERS) << ": passengers hold " << productShare << " of the nonzeros, below " << BENDERS_PRODUCT_SHARE;
+        reasons.push_back(reason.str());
+        strategy = fitsBudget(LP_DIVING) ? LP_DIVING : HEURISTIC;
+    }
+    else if (fitsBudget(BENDERS))
+        strategy = BENDERS;
+    else
+        strategy = fitsBudget(LP_DIVING) ? LP_DIVING : HEURISTIC;
+    if (strategy == HEURISTIC)
+        reasons.push_back(std::string(getName(HEURISTIC)) + ": time-boxed, always fits");
+    return strategy;
+}
+
+// time limits are shares of the budget; a dive closes with its MIP inside maxDivingTime
+void StrategyPlanner::apply() const
+{
+    const auto paramReg = ParamRegistry::instance();
+    paramReg->useBenders = strategy == BENDERS;
+    paramReg->useLpDiving = strategy == LP_DIVING || strategy == HEURISTIC;
+    switch (strategy)
+    {
+    case EXACT_MIP:
+        paramReg->maxIpRunTime = budget;
+        break;
+    case BENDERS:
+        // per master MIP, several of them per run
+        paramReg->maxIpRunTime = 0.2 * budget;
+        break;
+    case LP_DIVING:
+        paramReg->maxDivingTime = 0.9 * budget;
+        break;
+    case HEURISTIC:
+        // fix more arcs per LP so the dive ends in time, then improve by local search
+        paramReg->maxDivingTime = 0.6 * budget;
+        paramReg->divingBatchSize = std::max(paramReg->divingBatchSize, static_cast<int>(estimate.columns / 200));
+        paramReg->useLocalSearch = true;
+        paramReg->localSearchTime = 0.2 * budget;
+        paramReg->localSearchMipTime = 0.05 * budget;
+        break;
+    default:
+        break;
+    }
+}
+
+void StrategyPlanner::writeReport(const std::string& filename) const
+{
+    std::ofstream output;
+    output.open(filename.c_str());
+
+    output << "Rows:\t" << estimate.rows << std::endl;
+    output << "Columns:\t" << estimate.columns << std::endl;
+    output << "Nonzeros:\t" << estimate.nonzeros << std::endl;
+    output << "Passenger nonzeros:\t" << estimate.productNonzeros << std::endl;
+    output << "Budget:\t" << budget << std::endl;
+    output << "================== Predictions ==================" << std::endl;
+    output << "strategy\tseconds\truns\texponent" << std::endl;
+    for (int s = 0; s < static_cast<int>(fits.size()); s++)
+        output << getName(static_cast<Strategy>(s)) << "\t" << predicted[s] << "\t" << fits[s].runs << "\t" << fits[s].b << std::endl;
+    output << "================== Decision ==================" << std::endl;
+    for (const auto& reason : reasons)
+        output << reason << std::endl;
+    output << "Strategy:\t" << getName(strategy) << std::endl;
+
+    output.close();
+}
+
+void StrategyPlanner::recordRun(const std::string& runName, double seconds, double gap) const
+{
+    const std::string& filename = ParamRegistry::instance()->strategyHistory;
+    const bool exists = std::ifstream(filename.c_str()).good();
+    std::ofstream history(filename.c_str(), std::ofstream::app);
+    if (!exists)
+        history << "date,run,strategy,rows,columns,nonzeros,budget,seconds,gap" << std::endl;
+
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    history << date << "," << runName << "," << getName(strategy) << "," << estimate.rows << "," << estimate.columns << ","
+        << estimate.nonzeros << "," << budget << "," << seconds << ",";
+    if (gap >= 0)
+        history << gap;
+    history << std::endl;
+}
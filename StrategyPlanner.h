@@ -0,0 +1,59 @@
+#ifndef STRATEGY_PLANNER_H
+#define STRATEGY_PLANNER_H
+
+#include <string>
+#include <vector>
+
+class TS_Model;
+
+/* Picks the solve strategy for a built network before the formulation exists. The size of the
+ * formulation is counted from the network, the fleets and the product/leg incidence; the solve
+ * time of every strategy is predicted as exp(a) * nonzeros^b, with a and b fitted by least squares
+ * on log time over the recorded runs of that strategy that finished within their budget (a alone
+ * with the default exponent when they do not spread over sizes, the defaults without any runs).
+ * The first of exact MIP, Benders (when passengers carry most of the nonzeros), LP diving that is
+ * predicted to fit in strategySafety of maxRunTime is taken, else the time-boxed heuristic. The
+ * choice sets the matching ParamRegistry flags and time limits; every solve appends a row to
+ * strategyHistory for later calibration. */
+class StrategyPlanner {
+public:
+	enum Strategy { EXACT_MIP, BENDERS, LP_DIVING, HEURISTIC, NUM_STRATEGIES };
+
+	struct Estimate {
+		double rows;
+		double columns;
+		double nonzeros;
+		double productNonzeros;    // product columns, their capacity and demand entries
+	};
+
+	explicit StrategyPlanner(const TS_Model& model);
+
+	// reads the history, predicts and chooses for the given budget in seconds
+	Strategy choose(double budget);
+	void apply() const;
+	void writeReport(const std::string& filename) const;
+	void recordRun(const std::string& runName, double seconds, double gap) const;
+
+	const Estimate& getEstimate() const { return estimate; }
+	Strategy getStrategy() const { return strategy; }
+	static const char* getName(Strategy s);
+
+private:
+	struct Fit {
+		double a;
+		double b;
+		int runs;
+	};
+
+	Estimate estimate;
+	double budget;
+	Strategy strategy;
+	std::vector<Fit> fits;
+	std::vector<double> predicted;
+	std::vector<std::string> reasons;
+
+	void calibrate(const std::string& historyFile);
+	double predict(Strategy s) const;
+};
+
+#endif // !STRATEGY_PLANNER_H
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+// Maps codes (flight numbers, station codes) to dense integer IDs. Names live in a deque, so the
+// references handed out by name() stay valid while new codes are interned.
+class StringInterner {
+private:
+	std::unordered_map<std::string, int> ids;
+	std::deque<std::string> names;
+
+public:
+	int intern(const std::string& s)
+	{
+		auto it = ids.find(s);
+		if (it != ids.end())
+			return it->second;
+		const int id = static_cast<int>(names.size());
+		names.push_back(s);
+		ids.emplace(s, id);
+		return id;
+	}
+
+	int find(const std::string& s) const
+	{
+		auto it = ids.find(s);
+		return it == ids.end() ? -1 : it->second;
+	}
+
+	const std::string& name(int id) const { return names[id]; }
+	int size() const { return static_cast<int>(names.size()); }
+};
@@ -1,9 +1,44 @@
 #include "TS_Model.h"
+#include "ComponentSolver.h"
 #include "DataManager.h"
+#include "DelaySimulator.h"
+#include "FlatNetwork.h"
+#include "FleetBlocks.h"
+#include "FleetCountIndex.h"
+#include "LocalSearch.h"
+#include "ModelCache.h"
+#include "MpsWriter.h"
+#include "PassengerAllocation.h"
+#include "RevenueSimulator.h"
+#include "SolverGuidance.h"
+#include "StrategyPlanner.h"
+#include "TimeUtil.h"
 
-TS_Model::TS_Model(const std::string& d)
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <numeric>
+#include <set>
+#include <tuple>
+
+TS_Model::TS_Model(const std::string& d) :
+    progressLog(ParamRegistry::instance()->progressInterval)
 {
     cpuTime = 0;
+    lpBound = 0;
+    lpBoundValid = false;
+    fleetShortage = false;
+    minFleetSize = 0;
+    numUnbalancedStations = 0;
+    numBaseFlightArcs = 0;
+    numCapacityRows = 0;
+    numSeparationRounds = 0;
+    capacityViolated = false;
+    numBendersRounds = 0;
+    numBendersCuts = 0;
+    bendersBound = 0;
+    bendersProfit = 0;
+    scoped = false;
 
     setInputDirectory(d);
     setOutputDirectory(d + "out/");
@@ -14,10 +49,341 @@ TS_Model::TS_Model(const std::string& d)
 
 void TS_Model::optimize()
 {
+    const auto paramReg = ParamRegistry::instance();
+    bool decomposed = false;
+    if (paramReg->decomposeComponents)
+    {
+        // the component analysis needs the products, so the input is read up front
+        if (DataRegistry::instance()->schLegs.empty())
+            DataRegistry::instance()->readInputDataFile(input_directory);
+        ComponentSolver decomposition(input_directory, output_directory);
+        if (decomposition.analyze() > 1 && decomposition.solve())
+        {
+            assignment = decomposition.getAssignment();
+            retimedDepartures = decomposition.getRetimedDepartures();
+            decomposition.writeResults(output_directory + "result.out");
+            decomposed = true;
+        }
+    }
+    if (!decomposed)
+    {
+        // the planner sizes the formulation from the network, which buildModel then keeps
+        std::unique_ptr<StrategyPlanner> planner;
+        if (paramReg->autoStrategy)
+        {
+            if (DataRegistry::instance()->schLegs.empty())
+                DataRegistry::instance()->readInputDataFile(input_directory);
+            buildNetwork();
+            checkFleetSize();
+            planner.reset(new StrategyPlanner(*this));
+            planner->choose(paramReg->maxRunTime);
+            planner->apply();
+            planner->writeReport(output_directory + "strategy.out");
+            if (paramReg->printAlgProcess)
+                cout << "Strategy: " << StrategyPlanner::getName(planner->getStrategy()) << " for "
+                    << planner->getEstimate().nonzeros << " nonzeros" << endl;
+        }
+        prepare();
+        solve();
+        if (fleetShortage)
+            return;
+        writeResults();
+        if (planner)
+        {
+            double gap = -1;
+            if (paramReg->useBenders)
+                gap = bendersBound > 0 ? (bendersBound - bendersProfit) / bendersBound : -1;
+            else if (hasSolution() && masterCplex.isMIP())
+                gap = masterCplex.getMIPRelativeGap();
+            planner->recordRun(input_directory, cpuTime, gap);
+        }
+    }
+
+    if (paramReg->numDemandSamples > 0 && !assignment.empty())
+    {
+        RevenueSimulator simulator(assignment, RevenueSimulator::demandFromProducts(paramReg->demandCv));
+        const auto stats = simulator.run(paramReg->numDemandSamples, paramReg->simSeed);
+        simulator.writeReport(output_directory + "revenue.out", stats);
+    }
+
+    if (paramReg->numDelaySamples > 0 && !assignment.empty())
+    {
+        DelaySimulator simulator(assignment, retimedDepartures);
+        simulator.run(paramReg->numDelaySamples, paramReg->simSeed);
+        simulator.writeReport(output_directory + "delay.out");
+    }
+
+    if (paramReg->fleetCountStep > 0 && !assignment.empty())
+        FleetCountIndex(assignment, retimedDepartures).writeCounts(output_directory + "fleet_counts.csv", paramReg->fleetCountStep);
+}
+
+/* Reads the input and builds the model. The network needs only the fleets and the schedule, so
+ * with pipelinedStartup the product file is parsed on a second thread meanwhile; Concert objects
+ * are all created on this thread. Products only add stations and flight numbers the schedule
+ * does not have, nothing the network build reads. */
+void TS_Model::prepare()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto dataReg = DataRegistry::instance();
+    if (!dataReg->schLegs.empty())
+    {
+        // input already read, e.g. for the component analysis
+        buildModel();
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    dataReg->readAircraftFile(input_directory + "ac.csv");
+    dataReg->readScheduleInput(input_directory);
+    const double scheduleTime = elapsed();
+
+    double productTime = 0;
+    auto products = std::async(paramReg->pipelinedStartup ? std::launch::async : std::launch::deferred,
+        [this, dataReg, &elapsed, &productTime]() {
+            dataReg->readProductInput(input_directory);
+            dataReg->buildIncidence();
+            productTime = elapsed();
+        });
+
     buildNetwork();
-    buildFormulation();
-    solveModel();
-    writeResults();
+    checkFleetSize();
+
+    // a cached formulation replaces both halves, it only needs the products to be read
+    const ModelCache cache(input_directory);
+    bool loaded = false;
+    if (!scoped && cache.contains())
+    {
+        products.get();
+        loaded = loadCachedModel(cache);
+    }
+    double networkTime = 0;
+    if (!loaded)
+    {
+        buildNetworkFormulation();
+        networkTime = elapsed();
+        if (products.valid())
+            products.get();
+        buildProductFormulation();
+        saveCachedModel(cache);
+    }
+    if (paramReg->printAlgProcess)
+        cout << "Startup: schedule " << scheduleTime << "s, network rows " << networkTime << "s, products "
+            << productTime << "s, model " << elapsed() << "s" << endl;
+
+    if (paramReg->useRetiming)
+        generateRetimedCopies();
+}
+
+void TS_Model::buildModel()
+{
+    if (allNodes.empty())
+    {
+        buildNetwork();
+        checkFleetSize();
+    }
+    const ModelCache cache(input_directory);
+    if (!loadCachedModel(cache))
+    {
+        buildNetworkFormulation();
+        buildProductFormulation();
+        saveCachedModel(cache);
+    }
+    if (ParamRegistry::instance()->useRetiming)
+        generateRetimedCopies();
+}
+
+void TS_Model::exportMps(const std::string& filename)
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto dataReg = DataRegistry::instance();
+    if (dataReg->schLegs.empty())
+        dataReg->readInputDataFile(input_directory);
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!paramReg->outOfCoreDir.empty() && !scoped && allNodes.empty())
+    {
+        // the legs and products stay in memory, the nodes and arcs go to disk
+        FlatNetwork::build(paramReg->outOfCoreDir, static_cast<size_t>(paramReg->outOfCoreRunSize));
+        FlatNetwork network(paramReg->outOfCoreDir);
+        MpsWriter(network, legFixings).write(filename);
+    }
+    else
+    {
+        if (allNodes.empty())
+            buildNetwork();
+        MpsWriter(*this).write(filename);
+    }
+    if (paramReg->printAlgProcess)
+        cout << "Wrote " << filename << " in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            << "s" << endl;
+}
+
+// restricts the model to a set of legs and the products over them, by index in DataRegistry
+void TS_Model::setScope(const std::vector<int>& legs, const std::vector<int>& products)
+{
+    scoped = true;
+    modelLegs = legs;
+    modelProducts = products;
+}
+
+/* Lagrangian coordination of models that share the fleet counts: u_k counts the aircraft of fleet
+ * k on the count line, exactly the terms of FleetNum[k], and is priced in the objective. */
+void TS_Model::addFleetUsage()
+{
+    const int numAircraft = getNumTypeAircrafts();
+    char buf[100];
+    varFleetUsage = IloNumVarArray(env, numAircraft, 0, +IloInfinity);
+    FleetUsage = IloRangeArray(env, numAircraft);
+    for (int k = 0; k < numAircraft; k++)
+    {
+        IloExpr tempExpr(env);
+        for (IloExpr::LinearIterator it = FleetNum[k].getLinearIterator(); it.ok(); ++it)
+            tempExpr += it.getCoef() * it.getVar();
+        tempExpr += varFleetUsage[k];
+        std::sprintf(buf, "FleetUsage(%d)", k);
+        FleetUsage[k] = IloAdd(masterModel, IloRange(env, 0, tempExpr, 0, buf));
+        tempExpr.end();
+    }
+}
+
+void TS_Model::setFleetPrice(int k, double price)
+{
+    masterObj.setLinearCoef(varFleetUsage[k], -price);
+}
+
+double TS_Model::getFleetUsage(int k) const
+{
+    return masterCplex.getValue(varFleetUsage[k]);
+}
+
+void TS_Model::solve()
+{
+    const auto paramReg = ParamRegistry::instance();
+    if (fleetShortage)
+    {
+        // the precheck already showed the schedule cannot be flown
+        assignment.clear();
+        retimedDepartures.clear();
+        cpuTime = 0;
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    applyLegFixings();
+
+    // incumbent/bound trace of every MIP solve in this call
+    IloCplex::Callback progress;
+    if (paramReg->logProgress)
+    {
+        progressLog.begin(output_directory + "progress.csv");
+        progress = masterCplex.use(progressLog.callback(env));
+    }
+
+    if (paramReg->useBenders)
+        solveBenders();
+    else if (paramReg->lazyCapacityRows)
+        solveWithLazyRows();
+    else
+        runSolver();
+    // the moves are priced on the product variables, which a Benders master does not have
+    if (paramReg->useLocalSearch && !paramReg->useBenders)
+        improveByLocalSearch();
+    cpuTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (paramReg->logProgress)
+    {
+        // the final state, in case the search ended between two callback calls
+        if (hasSolution() && masterCplex.isMIP())
+            progressLog.record(true, masterCplex.getObjValue(), masterCplex.getBestObjValue(),
+                masterCplex.getMIPRelativeGap(), static_cast<long>(masterCplex.getNnodes()));
+        masterCplex.remove(progress);
+        progress.end();
+        progressLog.end();
+        progressLog.appendSummary(output_directory + "time_to_gap.csv", input_directory, paramReg->progressGapTargets);
+    }
+
+    updateSolution();
+}
+
+// aircraft of fleet k; the precheck verdict follows the new total
+void TS_Model::setFleetSize(int k, int n)
+{
+    FleetNum[k].setLB(-n);    // the row is stored as -(aircraft on the count line) >= -n
+    fleetSizes[k] = n;
+    if (!ParamRegistry::instance()->fleetPrecheck)
+        return;
+    const int available = std::accumulate(fleetSizes.begin(), fleetSizes.end(), 0);
+    fleetShortage = numUnbalancedStations > 0 || (!ParamRegistry::instance()->useRetiming && minFleetSize > available);
+}
+
+// the current solution becomes the MIP start of the next solve, in place of older ones
+void TS_Model::addSolutionAsStart()
+{
+    const int numAircraft = getNumTypeAircrafts();
+    IloNumVarArray vars(env);
+    IloNumArray vals(env);
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+        for (int k = 0; k < numAircraft; k++)
+            vars.add(varAssignFlightArcs[i][k]);
+    for (int i = 0; i < static_cast<int>(allGroundArcs.size()); i++)
+        for (int k = 0; k < numAircraft; k++)
+            vars.add(varAssignGroundArcs[i][k]);
+    for (int i = 0; i < static_cast<int>(varSatisfiedDemand.getSize()); i++)
+        vars.add(varSatisfiedDemand[i]);
+    if (varRevenue.getImpl())
+        vars.add(varRevenue);
+
+    masterCplex.getValues(vars, vals);
+    if (masterCplex.getNMIPStarts() > 0)
+        masterCplex.deleteMIPStarts(0, static_cast<int>(masterCplex.getNMIPStarts()));
+    masterCplex.addMIPStart(vars, vals, IloCplex::MIPStartCheckFeas);
+    vars.end();
+    vals.end();
+}
+
+// product p by position; demand is a row bound, or the variable's bound in lazy mode. The
+// Benders subproblems read it from the registry
+void TS_Model::setProductDemand(int p, double demand)
+{
+    DataRegistry::instance()->products[p]->setDemand(demand);
+    const int i = productSlot[p];
+    if (i < 0 || ParamRegistry::instance()->useBenders)
+        return;
+    if (ProductDemand[i].getImpl())
+        ProductDemand[i].setLB(-demand);    // the row is stored as -x >= -demand
+    else
+        varSatisfiedDemand[i].setUB(demand);
+}
+
+// leg index l is flown by fleet k only, on whichever of its arcs the solver picks
+void TS_Model::fixLeg(int l, int k)
+{
+    legFixings[l] = k;
+}
+
+void TS_Model::unfixLeg(int l)
+{
+    legFixings.erase(l);
+}
+
+/* Resets the flight-arc bounds, which LP diving leaves fixed, and closes the other fleets on the
+ * arcs of fixed legs. Runs before every solve so that a resident model starts from the same state. */
+void TS_Model::applyLegFixings()
+{
+    const int numAircraft = getNumTypeAircrafts();
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+    {
+        auto itFix = legFixings.find(getIndex(allFlightArcs[i]->getLeg()));
+        for (int k = 0; k < numAircraft; k++)
+        {
+            const bool closed = itFix != legFixings.end() && static_cast<int>(itFix->second) != k;
+            varAssignFlightArcs[i][k].setBounds(0, closed ? 0 : IloInfinity);
+        }
+    }
 }
 
 void TS_Model::buildNetwork()
@@ -26,21 +392,55 @@ void TS_Model::buildNetwork()
     auto& aircrafts = DataRegistry::instance()->aircrafts;
     auto& schLegs = DataRegistry::instance()->schLegs;
 
+    if (paramReg->timeBucket < 1 || 1440 % paramReg->timeBucket != 0)
+        throw std::invalid_argument("timeBucket must divide a day, got " + std::to_string(paramReg->timeBucket));
+    if (paramReg->countLine.size() != 4 || paramReg->countLine.find_first_not_of("0123456789") != std::string::npos
+        || toTimeString(toMinutes(paramReg->countLine)) != paramReg->countLine)
+        throw std::invalid_argument("countLine must be a time HHMM, got " + paramReg->countLine);
+
+    /* ********************* Turn Classes ******************** */
+    // an aircraft is ready at the arrival station once its fleet's minimum turn time has passed
+    turnClassTimes.clear();
+    for (const auto& ac : aircrafts)
+        turnClassTimes.push_back(ac->getTurnTime());
+    std::sort(turnClassTimes.begin(), turnClassTimes.end());
+    turnClassTimes.erase(std::unique(turnClassTimes.begin(), turnClassTimes.end()), turnClassTimes.end());
+    if (turnClassTimes.empty())
+        turnClassTimes.push_back(0);
+    fleetTurnClass.clear();
+    for (const auto& ac : aircrafts)
+        fleetTurnClass.push_back(static_cast<int>(std::lower_bound(turnClassTimes.begin(), turnClassTimes.end(),
+            ac->getTurnTime()) - turnClassTimes.begin()));
+
+    if (!scoped)
+    {
+        modelLegs.resize(schLegs.size());
+        std::iota(modelLegs.begin(), modelLegs.end(), 0);
+    }
+
     /* ********************* Flight Arcs ******************** */
     // flight and maintenance arcs and their nodes
-    for (const auto& leg : schLegs)
+    for (int l : modelLegs)
     {
-        this->addNode(leg->getDepTime(), leg->getDepStation());
-        this->addNode(leg->getArrTime(), leg->getArrStation());
-
-        const auto depNode = getNode(leg->getDepTime(), leg->getDepStation());
-        const auto arrNode = getNode(leg->getArrTime(), leg->getArrStation());
-        addArc(depNode, arrNode, leg.get());
+        const auto leg = schLegs[l];
+        const auto depNode = addNode(depNodeTime(toMinutes(leg->getDepTime())), leg->getDepStation());
+        const auto arrNode = addNode(readyNodeTime(toMinutes(leg->getArrTime()) + turnClassTimes[0]), leg->getArrStation());
+        addArc(depNode, arrNode, leg);
     }
 
     for (const auto& arc : allArcs) {
         allFlightArcs.push_back(arc.get());
     }
+    numBaseFlightArcs = static_cast<int>(allFlightArcs.size());
+
+    // shifted arrivals of the other turn classes only add nodes to the shared timeline
+    shiftedHeads.clear();
+    for (const auto pArc : allFlightArcs)
+        for (size_t c = 1; c < turnClassTimes.size(); c++)
+        {
+            const auto leg = pArc->getLeg();
+            shiftedHeads.push_back(addNode(readyNodeTime(toMinutes(leg->getArrTime()) + turnClassTimes[c]), leg->getArrStation()));
+        }
 
     /* ********************* Nodes ******************** */
     // sort all the nodes by time
@@ -88,9 +488,95 @@ void TS_Model::buildNetwork()
             }
         }
     }
+
+    if (paramReg->timeBucket > 1)
+        reportDiscretization();
+}
+
+/* Minimum number of aircraft that can fly every flight arc, whatever the fleet: with the flights
+ * fixed, the ground flow of a station is determined up to the number of aircraft parked there at
+ * midnight, which must cover the lowest point of its running arrivals minus departures. Turn times
+ * are those of the fastest fleet, so the result is a lower bound. A station whose arrivals and
+ * departures differ cannot be balanced at all. Shortages are written to precheck.out. */
+bool TS_Model::checkFleetSize()
+{
+    const auto paramReg = ParamRegistry::instance();
+    fleetShortage = false;
+    numUnbalancedStations = 0;
+    if (!paramReg->fleetPrecheck)
+        return true;
+
+    std::vector<int> net(allNodes.size(), 0);
+    minFleetSize = 0;
+    for (int i = 0; i < numBaseFlightArcs; i++)
+    {
+        const auto pArc = allFlightArcs[i];
+        net[pArc->getHeadNode()->getID()]++;
+        net[pArc->getTailNode()->getID()]--;
+        // airborne, or turning, at midnight
+        if (pArc->getHeadNode()->getTime() <= pArc->getTailNode()->getTime())
+            minFleetSize++;
+    }
+
+    // (aircraft needed, station, time of the lowest point)
+    std::vector<std::tuple<int, Station*, std::string> > bottlenecks;
+    std::vector<std::pair<Station*, int> > unbalanced;
+    for (const auto& itrMap : stationNodesMap)
+    {
+        int level = 0;
+        int lowest = 0;
+        const TS_Node* lowestNode = nullptr;
+        for (const auto node : itrMap.second)
+        {
+            level += net[node->getID()];
+            if (level < lowest)
+            {
+                lowest = level;
+                lowestNode = node;
+            }
+        }
+        if (level != 0)
+            unbalanced.emplace_back(itrMap.second.front()->getStation(), level);
+        if (lowestNode)
+            bottlenecks.emplace_back(-lowest, lowestNode->getStation(), lowestNode->getTime());
+        minFleetSize -= lowest;
+    }
+
+    int available = 0;
+    for (const auto& ac : DataRegistry::instance()->aircrafts)
+        available += ac->getNumAircrafts();
+    const bool shortOfAircraft = minFleetSize > available;
+    numUnbalancedStations = static_cast<int>(unbalanced.size());
+    if (!shortOfAircraft && unbalanced.empty())
+        return true;
+
+    // retimed copies change the network, the check on the nominal one is only a warning then
+    fleetShortage = !paramReg->useRetiming || !unbalanced.empty();
+    std::sort(bottlenecks.begin(), bottlenecks.end(), [](const std::tuple<int, Station*, std::string>& a,
+        const std::tuple<int, Station*, std::string>& b) -> bool {
+            return std::get<0>(a) > std::get<0>(b);
+        });
+
+    std::ofstream output((output_directory + "precheck.out").c_str());
+    output << "Minimum fleet:\t" << minFleetSize << std::endl;
+    output << "Available aircraft:\t" << available << std::endl;
+    for (const auto& stn : unbalanced)
+        output << "Unbalanced station:\t" << stn.first->getCode() << "\tarrivals - departures = " << stn.second << std::endl;
+    if (shortOfAircraft)
+    {
+        output << "================== Station Bottlenecks ==================" << std::endl;
+        for (const auto& b : bottlenecks)
+            output << std::get<1>(b)->getCode() << "\t" << std::get<2>(b) << "\t" << std::get<0>(b) << std::endl;
+    }
+    output.close();
+
+    cerr << "Fleet precheck failed: " << minFleetSize << " aircraft needed, " << available << " available, "
+        << unbalanced.size() << " unbalanced stations; see precheck.out" << endl;
+    return false;
 }
 
-void TS_Model::buildFormulation()
+// variables, costs and rows that only need the fleets and the network
+void TS_Model::buildNetworkFormulation()
 {
     masterModel = IloModel(env);
     masterCplex = IloCplex(masterModel);
@@ -99,6 +585,26 @@ void TS_Model::buildFormulation()
     initVariables();
     initObjective();
     initConstraints();
+}
+
+// the product half, once products and the leg/product incidence are loaded
+void TS_Model::buildProductFormulation()
+{
+    if (ParamRegistry::instance()->useBenders)
+    {
+        // passengers are left to the subproblems of solveBenders
+        initProductSlots();
+        varSatisfiedDemand = IloIntVarArray(env);
+        AircraftCapacity = IloRangeArray(env, static_cast<IloInt>(DataRegistry::instance()->schLegs.size()));
+        ProductDemand = IloRangeArray(env, static_cast<IloInt>(modelProducts.size()));
+        numCapacityRows = 0;
+    }
+    else
+    {
+        initProductVariables();
+        initProductObjective();
+        initProductConstraints();
+    }
 
     masterCplex.extract(masterModel);
     if (ParamRegistry::instance()->writeLpFiles)
@@ -110,10 +616,198 @@ void TS_Model::buildFormulation()
     masterCplex.setOut(env.getNullStream());
 }
 
-void TS_Model::initVariables()
+/* The map names the Concert objects in the order they are indexed here: flight and ground
+ * variables by arc and fleet, product variables, then FlightCover by leg, NetworkBalance by node
+ * and fleet, FleetNum, AircraftCapacity by leg and ProductDemand, "-" for a row that is not there.
+ * Its first line has the sizes it was written for. The map is written last and renamed into
+ * place, so a map on disk always has its model. */
+void TS_Model::saveCachedModel(const ModelCache& cache)
+{
+    if (!cache.enabled() || scoped)
+        return;
+    const auto start = std::chrono::steady_clock::now();
+    const int numAircraft = getNumTypeAircrafts();
+    const int numLegs = static_cast<int>(DataRegistry::instance()->schLegs.size());
+    auto name = [](const IloExtractable& e) -> std::string {
+        return e.getImpl() && e.getName() ? e.getName() : "-";
+    };
+
+    try
+    {
+        masterCplex.exportModel(cache.modelFile().c_str());
+
+        const std::string partial = cache.mapFile() + ".part";
+        std::ofstream output(partial.c_str());
+        output << allFlightArcs.size() << " " << allGroundArcs.size() << " " << numAircraft << " "
+            << modelProducts.size() << " " << allNodes.size() << " " << numLegs << "\n";
+        for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+            for (int k = 0; k < numAircraft; k++)
+                output << name(varAssignFlightArcs[i][k]) << "\n";
+        for (int i = 0; i < static_cast<int>(allGroundArcs.size()); i++)
+            for (int k = 0; k < numAircraft; k++)
+                output << name(varAssignGroundArcs[i][k]) << "\n";
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            output << name(varSatisfiedDemand[i]) << "\n";
+        for (int l = 0; l < numLegs; l++)
+            output << name(FlightCover[l]) << "\n";
+        for (int n = 0; n < static_cast<int>(allNodes.size()); n++)
+            for (int k = 0; k < numAircraft; k++)
+                output << name(NetworkBalance[n][k]) << "\n";
+        for (int k = 0; k < numAircraft; k++)
+            output << name(FleetNum[k]) << "\n";
+        for (int l = 0; l < numLegs; l++)
+            output << name(AircraftCapacity[l]) << "\n";
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            output << name(ProductDemand[i]) << "\n";
+        output.close();
+        std::remove(cache.mapFile().c_str());
+        if (!output || std::rename(partial.c_str(), cache.mapFile().c_str()) != 0)
+            throw std::runtime_error("cannot write " + cache.mapFile());
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Model cache: exception caught: " << e << endl;
+        return;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "Model cache: " << e.what() << endl;
+        return;
+    }
+    if (ParamRegistry::instance()->printAlgProcess)
+        cout << "Model cache miss " << cache.getKey() << ": saved in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << endl;
+}
+
+// false if there is no usable cached model; the caller then builds the formulation
+bool TS_Model::loadCachedModel(const ModelCache& cache)
 {
+    if (scoped || !cache.contains())
+        return false;
+    const auto start = std::chrono::steady_clock::now();
+    const int numAircraft = getNumTypeAircrafts();
     const int numLegs = static_cast<int>(DataRegistry::instance()->schLegs.size());
-    const int numProducts = static_cast<int>(DataRegistry::instance()->products.size());
+    initProductSlots();
+
+    std::ifstream input(cache.mapFile().c_str());
+    size_t sizes[6] = {};
+    for (auto& size : sizes)
+        input >> size;
+    const size_t expected[6] = { allFlightArcs.size(), allGroundArcs.size(), static_cast<size_t>(numAircraft),
+        modelProducts.size(), allNodes.size(), static_cast<size_t>(numLegs) };
+    if (!input || !std::equal(sizes, sizes + 6, expected))
+    {
+        cerr << "Model cache: " << cache.mapFile() << " does not fit the network, rebuilding" << endl;
+        return false;
+    }
+
+    try
+    {
+        masterModel = IloModel(env);
+        masterCplex = IloCplex(env);
+        masterObj = IloObjective(env);
+        IloNumVarArray vars(env);
+        IloRangeArray rows(env);
+        masterCplex.importModel(masterModel, cache.modelFile().c_str(), masterObj, vars, rows);
+
+        std::unordered_map<std::string, IloInt> varIndex;
+        std::unordered_map<std::string, IloInt> rowIndex;
+        for (IloInt j = 0; j < vars.getSize(); j++)
+            if (vars[j].getName())
+                varIndex[vars[j].getName()] = j;
+        for (IloInt j = 0; j < rows.getSize(); j++)
+            if (rows[j].getName())
+                rowIndex[rows[j].getName()] = j;
+        std::string entry;
+        auto nextVar = [&]() -> IloIntVar {
+            input >> entry;
+            const auto it = varIndex.find(entry);
+            if (it == varIndex.end())
+                throw std::runtime_error("variable " + entry + " is not in the cached model");
+            return IloIntVar(vars[it->second].getImpl());
+        };
+        auto nextRow = [&]() -> IloRange {
+            input >> entry;
+            if (entry == "-")
+                return IloRange();
+            const auto it = rowIndex.find(entry);
+            if (it == rowIndex.end())
+                throw std::runtime_error("row " + entry + " is not in the cached model");
+            return rows[it->second];
+        };
+
+        varAssignFlightArcs = IloIntVarArray2(env, static_cast<IloInt>(allFlightArcs.size()));
+        for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+        {
+            varAssignFlightArcs[i] = IloIntVarArray(env, numAircraft);
+            for (int k = 0; k < numAircraft; k++)
+                varAssignFlightArcs[i][k] = nextVar();
+        }
+        varAssignGroundArcs = IloIntVarArray2(env, static_cast<IloInt>(allGroundArcs.size()));
+        for (int i = 0; i < static_cast<int>(allGroundArcs.size()); i++)
+        {
+            varAssignGroundArcs[i] = IloIntVarArray(env, numAircraft);
+            for (int k = 0; k < numAircraft; k++)
+                varAssignGroundArcs[i][k] = nextVar();
+        }
+        varSatisfiedDemand = IloIntVarArray(env, static_cast<IloInt>(modelProducts.size()));
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            varSatisfiedDemand[i] = nextVar();
+
+        FlightCover = IloRangeArray(env, numLegs);
+        for (int l = 0; l < numLegs; l++)
+            FlightCover[l] = nextRow();
+        NetworkBalance = IloRangeArray2(env, static_cast<IloInt>(allNodes.size()));
+        for (int n = 0; n < static_cast<int>(allNodes.size()); n++)
+        {
+            NetworkBalance[n] = IloRangeArray(env, numAircraft);
+            for (int k = 0; k < numAircraft; k++)
+                NetworkBalance[n][k] = nextRow();
+        }
+        FleetNum = IloRangeArray(env, numAircraft);
+        fleetSizes.assign(numAircraft, 0);
+        for (int k = 0; k < numAircraft; k++)
+        {
+            FleetNum[k] = nextRow();
+            fleetSizes[k] = DataRegistry::instance()->aircrafts[k]->getNumAircrafts();
+        }
+        AircraftCapacity = IloRangeArray(env, numLegs);
+        numCapacityRows = 0;
+        for (int l = 0; l < numLegs; l++)
+        {
+            AircraftCapacity[l] = nextRow();
+            if (AircraftCapacity[l].getImpl())
+                numCapacityRows++;
+        }
+        ProductDemand = IloRangeArray(env, static_cast<IloInt>(modelProducts.size()));
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            ProductDemand[i] = nextRow();
+        vars.end();
+        rows.end();
+
+        linkArcsToNodes();
+        masterCplex.extract(masterModel);
+        masterCplex.setOut(env.getNullStream());
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Model cache: exception caught: " << e << ", rebuilding" << endl;
+        return false;
+    }
+    catch (const std::exception& e)
+    {
+        cerr << "Model cache: " << e.what() << ", rebuilding" << endl;
+        return false;
+    }
+
+    if (ParamRegistry::instance()->printAlgProcess)
+        cout << "Model cache hit " << cache.getKey() << ": loaded in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << endl;
+    return true;
+}
+
+void TS_Model::initVariables()
+{
     const int numFlightArcs = static_cast<int>(allFlightArcs.size());
     const int numGroundArcs = static_cast<int>(allGroundArcs.size());
     const int numAircraft = getNumTypeAircrafts();
@@ -122,13 +816,6 @@ void TS_Model::initVariables()
     try
     {
         // Variables
-        varSatisfiedDemand = IloIntVarArray(env, numProducts, 0, +IloInfinity);
-        for (int i = 0; i < numProducts; i++)
-        {
-            std::sprintf(buf, "Product(%ld)", DataRegistry::instance()->products[i]->getID());
-            varSatisfiedDemand[i] = IloIntVar(env, buf);
-        }
-
         varAssignFlightArcs = IloIntVarArray2(env, numFlightArcs);
         varAssignGroundArcs = IloIntVarArray2(env, numGroundArcs);
 
@@ -139,9 +826,9 @@ void TS_Model::initVariables()
         
         int j = 0;
         for (const auto pArc : allFlightArcs) {
-            for (int i = 0; i < 9; i++)
+            for (int i = 0; i < numAircraft; i++)
             {
-                std::sprintf(buf, "AssignFlight(%ld_%lld)",i, pArc->getLeg()->getID());
+                std::sprintf(buf, "AssignFlight(%d_%d)", i, pArc->getLeg()->getID());
                 varAssignFlightArcs[j][i] = IloIntVar(env, buf);
             }
             j++;
@@ -150,12 +837,11 @@ void TS_Model::initVariables()
         j = 0;
         for (const auto pArc : allGroundArcs) {
             const auto station = pArc->getHeadNode()->getStation();
-            for (int i = 0; i < 9; i++)
+            for (int i = 0; i < numAircraft; i++)
             {
-                std::sprintf(buf, "AssignGround(%ld_%d(%s_%s))", i, station->getID(),
-                    pArc->getTailNode()->getTime(), pArc->getHeadNode()->getTime());
+                std::sprintf(buf, "AssignGround(%d_%d(%s_%s))", i, station->getID(),
+                    pArc->getTailNode()->getTime().c_str(), pArc->getHeadNode()->getTime().c_str());
                 varAssignGroundArcs[j][i] = IloIntVar(env, buf);
-                cout << buf << endl;
             }
             j++;
         }
@@ -172,27 +858,58 @@ void TS_Model::initVariables()
     }
 }
 
-void TS_Model::initObjective()
+// products in the model and their positions in varSatisfiedDemand / ProductDemand
+void TS_Model::initProductSlots()
 {
-    const auto& schLegs = DataRegistry::instance()->schLegs;
-    const int numProducts = static_cast<int>(DataRegistry::instance()->products.size());
-    const int numLegs = static_cast<int>(schLegs.size());
+    const auto& products = DataRegistry::instance()->products;
+    if (!scoped)
+    {
+        modelProducts.resize(products.size());
+        std::iota(modelProducts.begin(), modelProducts.end(), 0);
+    }
+    productSlot.assign(products.size(), -1);
+    for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+        productSlot[modelProducts[i]] = i;
+}
 
+void TS_Model::initProductVariables()
+{
+    const auto& products = DataRegistry::instance()->products;
+    initProductSlots();
 
-    try {
-        IloExpr obj(env);
+    const int numProducts = static_cast<int>(modelProducts.size());
+    char buf[100];
 
-        // Earning of all products
+    try
+    {
+        varSatisfiedDemand = IloIntVarArray(env, numProducts, 0, +IloInfinity);
         for (int i = 0; i < numProducts; i++)
         {
-            obj += varSatisfiedDemand[i] * DataRegistry::instance()->products[i]->getFare();
+            std::sprintf(buf, "Product(%d)", products[modelProducts[i]]->getID());
+            varSatisfiedDemand[i] = IloIntVar(env, buf);
         }
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
+void TS_Model::initObjective()
+{
+    try {
+        IloExpr obj(env);
 
         // Cost of all flight legs
+        const int numAircraft = getNumTypeAircrafts();
         int j = 0;
         for (const auto& arc : allFlightArcs)
         {
-            for (int i = 0; i < 9; i++)
+            for (int i = 0; i < numAircraft; i++)
             {
                 obj -= varAssignFlightArcs[j][i] * DataRegistry::instance()->aircrafts[i]->getCost() * arc->getDuration() / 60;
             }
@@ -213,13 +930,31 @@ void TS_Model::initObjective()
     }
 }
 
+void TS_Model::initProductObjective()
+{
+    const auto& products = DataRegistry::instance()->products;
+
+    try {
+        // Earning of all products
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            masterObj.setLinearCoef(varSatisfiedDemand[i], products[modelProducts[i]]->getFare());
+    }
+    catch (const IloException& e)
+    {
+        std::cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Unknown exception caught!" << endl;
+    }
+}
+
 void TS_Model::initConstraints()
 {
     const auto& schLegs = DataRegistry::instance()->schLegs;
     const int numFlights = static_cast<int>(schLegs.size());
     const auto& aircrafts = DataRegistry::instance()->aircrafts;
     const int numAircraft = getNumTypeAircrafts();
-    const int numProducts = static_cast<int>(DataRegistry::instance()->products.size());
 
     char buf[100];
     // Flight Cover Constraints
@@ -228,14 +963,14 @@ void TS_Model::initConstraints()
     for (const auto& pArc : allFlightArcs)
     {
         IloExpr tempExpr(env);
-        for (int i = 0; i < 9; i++)
+        for (int i = 0; i < numAircraft; i++)
         {
             tempExpr += varAssignFlightArcs[j][i];
         }
 
         //
-        std::sprintf(buf, "FltCover(%ld)", schLegs[j]->getID());
-        FlightCover[j] = IloAdd(masterModel, IloRange(env, 1, tempExpr, 1, buf));
+        std::sprintf(buf, "FltCover(%d)", pArc->getLeg()->getID());
+        FlightCover[getIndex(pArc->getLeg())] = IloAdd(masterModel, IloRange(env, 1, tempExpr, 1, buf));
         tempExpr.end();
         
         j++;
@@ -245,36 +980,27 @@ void TS_Model::initConstraints()
     NetworkBalance = IloRangeArray2(env, static_cast<int>(this->allNodes.size()));
     for(int i = 0; i < static_cast<int>(this->allNodes.size()); i++)
         NetworkBalance[i] = IloRangeArray(env, this->getNumTypeAircrafts());
-    for (auto node : allNodes) {
-        node->enteringFlightArcs.clear();
-        node->leavingFlightArcs.clear();
-        node->enteringGroundArcs.clear();
-        node->leavingGroundArcs.clear();
-    }
+    linkArcsToNodes();
 
-    for (int i = 0; i < allFlightArcs.size(); i++)
-    {
-        allFlightArcs[i]->getHeadNode()->enteringFlightArcs.emplace_back(i);
-        allFlightArcs[i]->getTailNode()->leavingFlightArcs.emplace_back(i);
-    }
-    for (int i = 0; i < allGroundArcs.size(); i++)
-    {
-
-        allGroundArcs[i]->getHeadNode()->enteringGroundArcs.emplace_back(i);
-        allGroundArcs[i]->getTailNode()->leavingGroundArcs.emplace_back(i);
-    }
-
-    // constraints
-
-    //
-    for (int k = 0; k < 9 ;k++)
+    // constraints
+    //
+    for (int k = 0; k < numAircraft; k++)
     {
+        const int turnClass = fleetTurnClass[k];
         for (int n = 0; n < static_cast<int>(this->allNodes.size()); n++) 
         {
             const auto node = allNodes[n];
             IloExpr tempExpr(env);
-            for (int index : node->enteringFlightArcs) {
-                tempExpr += varAssignFlightArcs[index][k];
+            if (turnClass == 0) {
+                for (int index : node->enteringFlightArcs) {
+                    tempExpr += varAssignFlightArcs[index][k];
+                }
+            }
+            else {
+                for (const auto& shifted : node->enteringShiftedArcs) {
+                    if (shifted.first == turnClass)
+                        tempExpr += varAssignFlightArcs[shifted.second][k];
+                }
             }
             for (const auto index : node->leavingFlightArcs) {
                 tempExpr -= varAssignFlightArcs[index][k];
@@ -286,68 +1012,106 @@ void TS_Model::initConstraints()
                 tempExpr -= varAssignGroundArcs[index][k];
             }
             //======
-            std::sprintf(buf, "FlowBalance(%s,%ld)", node->getTime(), node->getStation()->getID());
+            std::sprintf(buf, "FlowBalance(%s,%d,%d)", node->getTime().c_str(), node->getStation()->getID(), k);
             NetworkBalance[n][k] = IloAdd(masterModel, IloRange(env, 0, tempExpr, 0, buf));
             // masterMod.add(IloRange(env, rhs, tempExpr, rhs, buf));
             tempExpr.end();
         }   
     }
 
-    //Aircraft Capacity Constraint
-    AircraftCapacity = IloRangeArray(env, numProducts);
-    int i = 0;
-    for (const auto& leg : DataRegistry::instance()->schLegs)
-    {
-        IloExpr tempExpr(env);
-        for (int j = 0; j < 9; j++)
-        {
-            tempExpr += varAssignFlightArcs[i][j] * aircrafts[j]->getCapacity();
-        }
-        int j = 0;
-        for (const auto& product : DataRegistry::instance()->products)
+    //Fleet Number Constraint
+    // the arcs over the count line are the same for all fleets of a turn class; an aircraft stays
+    // on its flight arc until the turn is complete, and a station has one ground arc over the line
+    std::vector<std::vector<int> > crossingFlightArcs(turnClassTimes.size());
+    for (int j = 0; j < static_cast<int>(allFlightArcs.size()); j++)
+        for (int c = 0; c < static_cast<int>(turnClassTimes.size()); c++)
         {
-            for (const auto& fltNum : product->getFltNums())
-                if (fltNum == leg->getFlightNum())
-                    tempExpr -= varSatisfiedDemand[j];
-            j++;
+            const auto head = c == 0 ? allFlightArcs[j]->getHeadNode() : getShiftedHead(j, c);
+            if (crossesCountLine(allFlightArcs[j]->getStartTime(), head->getTime()))
+                crossingFlightArcs[c].push_back(j);
         }
-        std::sprintf(buf, "AircraftCapacity(%s)", leg->getFlightNum());
-        AircraftCapacity[i] = IloAdd(masterModel, IloRange(env, 0, tempExpr,+IloInfinity, buf));
-        // masterMod.add(IloRange(env, rhs, tempExpr, rhs, buf));
-        tempExpr.end();
-        i++;
-    }
+    std::vector<int> crossingGroundArcs;
+    for (int j = 0; j < static_cast<int>(allGroundArcs.size()); j++)
+        if (crossesCountLine(allGroundArcs[j]->getStartTime(), allGroundArcs[j]->getEndTime()))
+            crossingGroundArcs.push_back(j);
 
-    //Fleet Number Constraint
     FleetNum = IloRangeArray(env, numAircraft);
+    fleetSizes.assign(numAircraft, 0);
     for (int i = 0; i < numAircraft; i++)
     {
+        fleetSizes[i] = aircrafts[i]->getNumAircrafts();
         IloExpr tempExpr(env);
-        int j = 0;
-        for (const auto& fArc : allFlightArcs)
-        {
-            if ((fArc->getLeg()->getDepTime() <= std::string("2300")) && (fArc->getLeg()->getArrTime() >= std::string("2300")))
-                tempExpr -= varAssignFlightArcs[j][i];
-        }
-        j = 0;
-        for (const auto& gArc : allGroundArcs)
-            if ((gArc->getTailNode()->getTime() <= std::string("2300")) && (gArc->getHeadNode()->getTime() >= std::string("2300")))
-                tempExpr -= varAssignGroundArcs[j][i];
+        for (int j : crossingFlightArcs[fleetTurnClass[i]])
+            tempExpr -= varAssignFlightArcs[j][i];
+        for (int j : crossingGroundArcs)
+            tempExpr -= varAssignGroundArcs[j][i];
         tempExpr += aircrafts[i]->getNumAircrafts();
 
+        std::sprintf(buf, "FleetNum(%d)", i);
         FleetNum[i] = IloAdd(masterModel, IloRange(env, 0, tempExpr, +IloInfinity, buf));
         tempExpr.end();
 
     }
+}
+
+// arc lists of the nodes, by position in allFlightArcs / allGroundArcs
+void TS_Model::linkArcsToNodes()
+{
+    for (auto node : allNodes) {
+        node->enteringFlightArcs.clear();
+        node->leavingFlightArcs.clear();
+        node->enteringGroundArcs.clear();
+        node->leavingGroundArcs.clear();
+        node->enteringShiftedArcs.clear();
+    }
+
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+    {
+        allFlightArcs[i]->getHeadNode()->enteringFlightArcs.emplace_back(i);
+        allFlightArcs[i]->getTailNode()->leavingFlightArcs.emplace_back(i);
+    }
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+        for (int c = 1; c < static_cast<int>(turnClassTimes.size()); c++)
+            getShiftedHead(i, c)->enteringShiftedArcs.emplace_back(c, i);
+    for (int i = 0; i < static_cast<int>(allGroundArcs.size()); i++)
+    {
+
+        allGroundArcs[i]->getHeadNode()->enteringGroundArcs.emplace_back(i);
+        allGroundArcs[i]->getTailNode()->leavingGroundArcs.emplace_back(i);
+    }
+}
+
+void TS_Model::initProductConstraints()
+{
+    const auto& products = DataRegistry::instance()->products;
+    const int numFlights = static_cast<int>(DataRegistry::instance()->schLegs.size());
+    const int numProducts = static_cast<int>(modelProducts.size());
+    char buf[100];
+
+    //Aircraft Capacity Constraint
+    // in lazy mode the rows are only added once separation finds them violated
+    // rows are indexed by leg, base flight arc i flies modelLegs[i]
+    const bool lazyRows = ParamRegistry::instance()->lazyCapacityRows;
+    AircraftCapacity = IloRangeArray(env, numFlights);
+    numCapacityRows = 0;
+    if (!lazyRows)
+        for (int i = 0; i < numBaseFlightArcs; i++)
+            addCapacityRow(modelLegs[i], std::vector<int>(1, i));
 
     //Demand Constraint
+    // in lazy mode demand is a bound on the product variable and needs no row at all
     ProductDemand = IloRangeArray(env, numProducts);
     for (int i = 0; i < numProducts; i++)
     {
+        if (lazyRows)
+        {
+            varSatisfiedDemand[i].setUB(products[modelProducts[i]]->getDemand());
+            continue;
+        }
         IloExpr tempExpr(env);
-        tempExpr = DataRegistry::instance()->products[i]->getDemand() - varSatisfiedDemand[i];
+        tempExpr = products[modelProducts[i]]->getDemand() - varSatisfiedDemand[i];
 
-        std::sprintf(buf, "ProductDemand(%ld)", i);
+        std::sprintf(buf, "ProductDemand(%d)", i);
         ProductDemand[i] = IloAdd(masterModel, IloRange(env, 0, tempExpr, +IloInfinity, buf));
         // masterMod.add(IloRange(env, rhs, tempExpr, rhs, buf));
         tempExpr.end();
@@ -379,12 +1143,663 @@ void TS_Model::initConstraints()
 
 }
 
+/* Flexible departures: copies of a flight arc shifted by multiples of retimeStep within
+ * +-retimeWindow minutes. Copies are priced against the duals of the LP relaxation and only the
+ * attractive ones are added, until none prices out or the flight arcs reach maxCopyRatio times
+ * their nominal number. */
+void TS_Model::generateRetimedCopies()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    const int numAircraft = getNumTypeAircrafts();
+    const int maxFlightArcs = static_cast<int>(paramReg->maxCopyRatio * numBaseFlightArcs);
+    // (base arc, shift) pairs that already have a copy
+    std::set<std::pair<int, int> > generated;
+
+    try
+    {
+        std::vector<IloConversion> relaxations;
+        relaxIntegrality(relaxations);
+
+        IloNumArray duals(env);
+        for (int iter = 0; iter < paramReg->maxIterations; iter++)
+        {
+            if (!masterCplex.solve())
+                break;
+
+            // (reduced cost, base arc, shift); a copy whose end points are not in the network yet is
+            // priced with the node that precedes it on the station timeline
+            std::vector<std::tuple<double, int, int> > candidates;
+            dispatchFleetWidth(numAircraft, [&](auto width) {
+                constexpr int W = decltype(width)::value;
+                const int numNodes = static_cast<int>(allNodes.size());
+                const int numClasses = static_cast<int>(turnClassTimes.size());
+                FleetArcTable<W> balanceDual(numNodes, numAircraft);
+                for (int n = 0; n < numNodes; n++)
+                {
+                    masterCplex.getDuals(duals, NetworkBalance[n]);
+                    for (int k = 0; k < numAircraft; k++)
+                        balanceDual.at(n, k) = duals[k];
+                }
+                // rows: seats, FleetNum dual, then a mask of the fleets of every turn class
+                FleetArcTable<W> fleetRows(2 + numClasses, numAircraft);
+                masterCplex.getDuals(duals, FleetNum);
+                for (int k = 0; k < numAircraft; k++)
+                {
+                    fleetRows.at(0, k) = aircrafts[k]->getCapacity();
+                    fleetRows.at(1, k) = duals[k];
+                    fleetRows.at(2 + fleetTurnClass[k], k) = 1;
+                }
+                // flying cost, and the fleets a fixed leg is still open to
+                FleetArcTable<W> arcCost(numBaseFlightArcs, numAircraft);
+                FleetArcTable<W> eligible(numBaseFlightArcs, numAircraft);
+                for (int i = 0; i < numBaseFlightArcs; i++)
+                {
+                    auto itFix = legFixings.find(getIndex(allFlightArcs[i]->getLeg()));
+                    for (int k = 0; k < numAircraft; k++)
+                    {
+                        arcCost.at(i, k) = -aircrafts[k]->getCost() * allFlightArcs[i]->getDuration() / 60.0;
+                        eligible.at(i, k) = itFix == legFixings.end() || static_cast<int>(itFix->second) == k ? 1 : 0;
+                    }
+                }
+
+                const int nb = arcCost.getNumBlocks();
+                std::vector<FleetBlock<W> > rc(nb);
+                for (int i = 0; i < numBaseFlightArcs; i++)
+                {
+                    const auto pArc = allFlightArcs[i];
+                    const auto leg = pArc->getLeg();
+                    const int legIdx = getIndex(leg);
+                    const double coverDual = masterCplex.getDual(FlightCover[legIdx]);
+                    const double capDual = AircraftCapacity[legIdx].getImpl() ? masterCplex.getDual(AircraftCapacity[legIdx]) : 0.0;
+                    const int dep = toMinutes(pArc->getStartTime());
+                    const int arr = toMinutes(leg->getArrTime());
+                    for (int shift = -paramReg->retimeWindow; shift <= paramReg->retimeWindow; shift += paramReg->retimeStep)
+                    {
+                        if (shift == 0 || generated.count(std::make_pair(i, shift)))
+                            continue;
+                        const std::string depTime = depNodeTime(dep + shift);
+                        const int tailId = getTimelineNode(depTime, leg->getDepStation())->getID();
+                        std::copy(arcCost.row(i), arcCost.row(i) + nb, rc.begin());
+                        fleetAxpy(rc.data(), -capDual, fleetRows.row(0), nb);
+                        fleetAxpy(rc.data(), 1.0, balanceDual.row(tailId), nb);
+                        for (int c = 0; c < numClasses; c++)
+                        {
+                            const std::string headTime = readyNodeTime(arr + shift + turnClassTimes[c]);
+                            const int headId = getTimelineNode(headTime, leg->getArrStation())->getID();
+                            fleetMaskedAxpy(rc.data(), -1.0, fleetRows.row(2 + c), balanceDual.row(headId), nb);
+                            if (crossesCountLine(depTime, headTime))
+                                fleetMaskedAxpy(rc.data(), 1.0, fleetRows.row(2 + c), fleetRows.row(1), nb);
+                        }
+                        const double best = fleetMax(rc.data(), eligible.row(i), nb) - coverDual;
+                        // scoreThreshold is stated for minimization: attractive when -rc drops below it
+                        if (-best < paramReg->scoreThreshold)
+                            candidates.emplace_back(best, i, shift);
+                    }
+                }
+            });
+
+            std::sort(candidates.rbegin(), candidates.rend());
+            int added = 0;
+            for (const auto& cand : candidates)
+            {
+                if (static_cast<int>(allFlightArcs.size()) >= maxFlightArcs)
+                    break;
+                addFlightCopy(std::get<1>(cand), std::get<2>(cand), relaxations);
+                generated.emplace(std::get<1>(cand), std::get<2>(cand));
+                added++;
+            }
+
+            if (paramReg->printAlgProcess)
+                cout << "Retiming iteration " << iter << ": LP " << masterCplex.getObjValue() << ", " << added
+                    << " copies added, " << allFlightArcs.size() - numBaseFlightArcs << " in total" << endl;
+            if (added == 0)
+                break;
+        }
+        duals.end();
+        restoreIntegrality(relaxations);
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
+std::string TS_Model::depNodeTime(int minutes) const
+{
+    return toTimeString(bucketDown(minutes, ParamRegistry::instance()->timeBucket));
+}
+
+std::string TS_Model::readyNodeTime(int minutes) const
+{
+    return toTimeString(bucketUp(minutes, ParamRegistry::instance()->timeBucket));
+}
+
+/* What the time buckets cost: nodes and arcs of the minute-level network against the bucketed
+ * one, and the turns that no longer connect. An aircraft ready at minute a could take a departure
+ * at d >= a; once a rounds up and d rounds down that holds only if a is at or before d's bucket
+ * boundary. Counted per turn class, into discretization.out. */
+void TS_Model::reportDiscretization()
+{
+    const int bucket = ParamRegistry::instance()->timeBucket;
+    const auto& schLegs = DataRegistry::instance()->schLegs;
+    const int numClasses = static_cast<int>(turnClassTimes.size());
+
+    std::set<std::pair<int, int> > minuteNodes;
+    // station ID -> departure minutes, and ready minutes per turn class
+    std::map<int, std::vector<int> > departures;
+    std::map<int, std::vector<std::vector<int> > > readyTimes;
+    std::map<int, Station*> stations;
+    for (int l : modelLegs)
+    {
+        const auto leg = schLegs[l];
+        const int dep = toMinutes(leg->getDepTime());
+        const int arrStation = leg->getArrStation()->getID();
+        minuteNodes.emplace(leg->getDepStation()->getID(), dep);
+        departures[leg->getDepStation()->getID()].push_back(dep);
+        stations[leg->getDepStation()->getID()] = leg->getDepStation();
+        stations[arrStation] = leg->getArrStation();
+        auto& ready = readyTimes[arrStation];
+        ready.resize(numClasses);
+        for (int c = 0; c < numClasses; c++)
+        {
+            const int a = toMinutes(toTimeString(toMinutes(leg->getArrTime()) + turnClassTimes[c]));
+            minuteNodes.emplace(arrStation, a);
+            ready[c].push_back(a);
+        }
+    }
+
+    int lostTotal = 0;
+    std::vector<std::pair<Station*, int> > lostByStation;
+    for (auto& itr : readyTimes)
+    {
+        auto itDep = departures.find(itr.first);
+        if (itDep == departures.end())
+            continue;
+        int lost = 0;
+        for (auto& ready : itr.second)
+        {
+            std::sort(ready.begin(), ready.end());
+            for (int d : itDep->second)
+                lost += static_cast<int>(std::upper_bound(ready.begin(), ready.end(), d)
+                    - std::upper_bound(ready.begin(), ready.end(), bucketDown(d, bucket)));
+        }
+        if (lost > 0)
+            lostByStation.emplace_back(stations[itr.first], lost);
+        lostTotal += lost;
+    }
+
+    const size_t minuteArcs = modelLegs.size() + minuteNodes.size();
+    const size_t bucketArcs = allFlightArcs.size() + allGroundArcs.size();
+    std::ofstream output((output_directory + "discretization.out").c_str());
+    output << "Time bucket:\t" << bucket << std::endl;
+    output << "Nodes:\t" << minuteNodes.size() << "\t" << allNodes.size() << std::endl;
+    output << "Arcs:\t" << minuteArcs << "\t" << bucketArcs << std::endl;
+    output << "Connections lost:\t" << lostTotal << std::endl;
+    for (const auto& stn : lostByStation)
+        output << stn.first->getCode() << "\t" << stn.second << std::endl;
+    output.close();
+
+    if (ParamRegistry::instance()->printAlgProcess)
+        cout << "Time bucket " << bucket << " min: nodes " << minuteNodes.size() << " -> " << allNodes.size() << ", arcs "
+            << minuteArcs << " -> " << bucketArcs << ", " << lostTotal << " connections lost" << endl;
+}
+
+// node at `_t` or, if there is none, the one before it on the station's cyclic timeline
+TS_Node* TS_Model::getTimelineNode(const std::string& _t, Station* _s)
+{
+    const auto& staNodes = stationNodesMap[_s->getID()];
+    auto it = std::upper_bound(staNodes.begin(), staNodes.end(), _t, [](const std::string& t, const TS_Node* n) -> bool {
+        return t < n->getTime();
+        });
+    return it == staNodes.begin() ? staNodes.back() : *std::prev(it);
+}
+
+// adds a node to an already formulated network by splitting the ground arc that spans `_t`
+TS_Node* TS_Model::insertNode(const std::string& _t, Station* _s, std::vector<IloConversion>& relaxations)
+{
+    if (auto existing = getNode(_t, _s))
+        return existing;
+
+    const int numAircraft = getNumTypeAircrafts();
+    auto& staNodes = stationNodesMap[_s->getID()];
+    auto pos = std::upper_bound(staNodes.begin(), staNodes.end(), _t, [](const std::string& t, const TS_Node* n) -> bool {
+        return t < n->getTime();
+        });
+    TS_Node* prev = pos == staNodes.begin() ? staNodes.back() : *std::prev(pos);
+    const int g = prev->leavingGroundArcs.front();
+    TS_Node* next = allGroundArcs[g]->getHeadNode();
+
+    TS_Node* node = addNode(_t, _s);
+    node->setID(static_cast<int>(allNodes.size()) - 1);
+    staNodes.insert(pos, node);
+
+    // prev -> node keeps ground arc g, node -> next is new
+    allGroundArcs[g]->setHeadNode(node);
+    addArc(node, next, nullptr);
+    const int h = static_cast<int>(allGroundArcs.size());
+    allGroundArcs.push_back(allArcs.back().get());
+    node->enteringGroundArcs.push_back(g);
+    node->leavingGroundArcs.push_back(h);
+    std::replace(next->enteringGroundArcs.begin(), next->enteringGroundArcs.end(), g, h);
+
+    char buf[100];
+    IloIntVarArray vars(env, numAircraft, 0, +IloInfinity);
+    IloRangeArray rows(env, numAircraft);
+    for (int k = 0; k < numAircraft; k++)
+    {
+        std::sprintf(buf, "AssignGround(%d_%d(%s_%s))", k, _s->getID(), _t.c_str(), next->getTime().c_str());
+        vars[k] = IloIntVar(env, buf);
+    }
+    varAssignGroundArcs.add(vars);
+    relaxations.push_back(IloAdd(masterModel, IloConversion(env, vars, ILOFLOAT)));
+
+    for (int k = 0; k < numAircraft; k++)
+    {
+        // g no longer enters next; at a single-node station next is prev, which g still leaves
+        NetworkBalance[next->getID()][k].setLinearCoef(varAssignGroundArcs[g][k], next == prev ? -1 : 0);
+        NetworkBalance[next->getID()][k].setLinearCoef(vars[k], 1);
+        std::sprintf(buf, "FlowBalance(%s,%d,%d)", _t.c_str(), _s->getID(), k);
+        rows[k] = IloAdd(masterModel, IloRange(env, 0, varAssignGroundArcs[g][k] - vars[k], 0, buf));
+
+        FleetNum[k].setLinearCoef(varAssignGroundArcs[g][k], crossesCountLine(prev->getTime(), _t) ? -1 : 0);
+        FleetNum[k].setLinearCoef(vars[k], crossesCountLine(_t, next->getTime()) ? -1 : 0);
+    }
+    NetworkBalance.add(rows);
+    return node;
+}
+
+void TS_Model::addFlightCopy(int baseArc, int shift, std::vector<IloConversion>& relaxations)
+{
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    const int numAircraft = getNumTypeAircrafts();
+    const auto base = allFlightArcs[baseArc];
+    const auto leg = base->getLeg();
+    const int legIdx = getIndex(leg);
+    const int dep = toMinutes(base->getStartTime()) + shift;
+    const int arr = toMinutes(leg->getArrTime()) + shift;
+
+    TS_Node* tail = insertNode(depNodeTime(dep), leg->getDepStation(), relaxations);
+    TS_Node* head = insertNode(readyNodeTime(arr + turnClassTimes[0]), leg->getArrStation(), relaxations);
+    addArc(tail, head, leg);
+    const int i = static_cast<int>(allFlightArcs.size());
+    allFlightArcs.push_back(allArcs.back().get());
+    tail->leavingFlightArcs.push_back(i);
+    head->enteringFlightArcs.push_back(i);
+    for (int c = 1; c < static_cast<int>(turnClassTimes.size()); c++)
+    {
+        TS_Node* shifted = insertNode(readyNodeTime(arr + turnClassTimes[c]), leg->getArrStation(), relaxations);
+        shiftedHeads.push_back(shifted);
+        shifted->enteringShiftedArcs.emplace_back(c, i);
+    }
+
+    char buf[100];
+    IloIntVarArray vars(env, numAircraft, 0, +IloInfinity);
+    for (int k = 0; k < numAircraft; k++)
+    {
+        std::sprintf(buf, "AssignFlight(%d_%d@%s)", k, leg->getID(), tail->getTime().c_str());
+        vars[k] = IloIntVar(env, buf);
+    }
+    varAssignFlightArcs.add(vars);
+    relaxations.push_back(IloAdd(masterModel, IloConversion(env, vars, ILOFLOAT)));
+
+    for (int k = 0; k < numAircraft; k++)
+    {
+        const auto kHead = getArcHead(i, k);
+        masterObj.setLinearCoef(vars[k], -aircrafts[k]->getCost() * base->getDuration() / 60.0);
+        FlightCover[legIdx].setLinearCoef(vars[k], 1);
+        if (AircraftCapacity[legIdx].getImpl())
+            AircraftCapacity[legIdx].setLinearCoef(vars[k], aircrafts[k]->getCapacity());
+        NetworkBalance[tail->getID()][k].setLinearCoef(vars[k], -1);
+        NetworkBalance[kHead->getID()][k].setLinearCoef(vars[k], 1);
+        if (crossesCountLine(tail->getTime(), kHead->getTime()))
+            FleetNum[k].setLinearCoef(vars[k], -1);
+    }
+}
+
+void TS_Model::runSolver()
+{
+    if (ParamRegistry::instance()->useLpDiving)
+        solveLpDiving();
+    else
+        solveModel();
+}
+
+/* Branching priorities and zero fixes of SolverGuidance for the next MIP. The fixes of an earlier
+ * solve are lifted first: a leg unfixed since then may have opened a fleet at a station. */
+void TS_Model::applySolverGuidance()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const int numAircraft = getNumTypeAircrafts();
+    for (const auto& fix : guidanceFixes)
+        varAssignGroundArcs[fix.first][fix.second].setBounds(0, IloInfinity);
+    guidanceFixes.clear();
+    if (!paramReg->solverGuidance)
+        return;
+
+    const SolverGuidance guidance(*this);
+    IloNumVarArray vars(env);
+    IloNumArray priorities(env);
+    const auto& flightPriority = guidance.getFlightPriorities();
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+        for (int k = 0; k < numAircraft; k++)
+        {
+            vars.add(varAssignFlightArcs[i][k]);
+            priorities.add(flightPriority[i]);
+        }
+    const auto& groundPriority = guidance.getGroundPriorities();
+    for (int g = 0; g < static_cast<int>(allGroundArcs.size()); g++)
+        if (groundPriority[g] > 0)
+            for (int k = 0; k < numAircraft; k++)
+            {
+                vars.add(varAssignGroundArcs[g][k]);
+                priorities.add(groundPriority[g]);
+            }
+    masterCplex.setPriorities(vars, priorities);
+    const auto numPriorities = vars.getSize();
+    vars.end();
+    priorities.end();
+
+    guidanceFixes = guidance.getGroundFixes();
+    for (const auto& fix : guidanceFixes)
+        varAssignGroundArcs[fix.first][fix.second].setBounds(0, 0);
+    if (paramReg->printAlgProcess)
+        cout << "Solver guidance: " << numPriorities << " priorities, " << guidance.getNumHubs() << " hubs, "
+            << guidanceFixes.size() << " ground variables fixed to zero" << endl;
+}
+
+void TS_Model::relaxIntegrality(std::vector<IloConversion>& relaxations)
+{
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+        relaxations.push_back(IloAdd(masterModel, IloConversion(env, varAssignFlightArcs[i], ILOFLOAT)));
+    for (int i = 0; i < static_cast<int>(allGroundArcs.size()); i++)
+        relaxations.push_back(IloAdd(masterModel, IloConversion(env, varAssignGroundArcs[i], ILOFLOAT)));
+    if (varSatisfiedDemand.getSize() > 0)
+        relaxations.push_back(IloAdd(masterModel, IloConversion(env, varSatisfiedDemand, ILOFLOAT)));
+}
+
+void TS_Model::restoreIntegrality(std::vector<IloConversion>& relaxations)
+{
+    for (auto& conv : relaxations)
+    {
+        masterModel.remove(conv);
+        conv.end();
+    }
+    relaxations.clear();
+}
+
+bool TS_Model::hasSolution() const
+{
+    const auto status = masterCplex.getStatus();
+    return status == IloAlgorithm::Feasible || status == IloAlgorithm::Optimal;
+}
+
+// capacity row of leg l over all flight arcs (nominal and retimed) that fly it
+void TS_Model::addCapacityRow(int l, const std::vector<int>& arcs)
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const int numAircraft = getNumTypeAircrafts();
+    char buf[100];
+
+    IloExpr tempExpr(env);
+    for (int arc : arcs)
+        for (int k = 0; k < numAircraft; k++)
+            tempExpr += varAssignFlightArcs[arc][k] * aircrafts[k]->getCapacity();
+    for (int p = dataReg->legProductStart[l]; p < dataReg->legProductStart[l + 1]; p++)
+        tempExpr -= varSatisfiedDemand[productSlot[dataReg->legProducts[p]]];
+    std::sprintf(buf, "AircraftCapacity(%s_%d)", dataReg->schLegs[l]->getFlightNum().c_str(), dataReg->schLegs[l]->getID());
+    AircraftCapacity[l] = IloAdd(masterModel, IloRange(env, 0, tempExpr, +IloInfinity, buf));
+    tempExpr.end();
+    numCapacityRows++;
+}
+
+// adds the capacity rows the current solution violates, returns how many
+int TS_Model::addViolatedCapacityRows()
+{
+    const auto dataReg = DataRegistry::instance();
+    const auto& aircrafts = dataReg->aircrafts;
+    const int numAircraft = getNumTypeAircrafts();
+    const int numLegs = static_cast<int>(dataReg->schLegs.size());
+
+    std::vector<std::vector<int> > legArcs(numLegs);
+    std::vector<double> seats(numLegs, 0.0);
+    IloNumArray vals(env);
+    for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+    {
+        const int l = getIndex(allFlightArcs[i]->getLeg());
+        legArcs[l].push_back(i);
+        masterCplex.getValues(vals, varAssignFlightArcs[i]);
+        for (int k = 0; k < numAircraft; k++)
+            seats[l] += vals[k] * aircrafts[k]->getCapacity();
+    }
+    masterCplex.getValues(vals, varSatisfiedDemand);
+
+    int added = 0;
+    for (int l : modelLegs)
+    {
+        if (AircraftCapacity[l].getImpl())
+            continue;
+        double load = 0;
+        for (int p = dataReg->legProductStart[l]; p < dataReg->legProductStart[l + 1]; p++)
+            load += vals[productSlot[dataReg->legProducts[p]]];
+        if (load > seats[l] + 1.0e-6)
+        {
+            addCapacityRow(l, legArcs[l]);
+            added++;
+        }
+    }
+    vals.end();
+    return added;
+}
+
+/* Starts without capacity rows and separates the violated ones: first on the LP relaxation, which
+ * is cheap and catches most of them, then on the integer solutions until none is violated. */
+void TS_Model::solveWithLazyRows()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    numSeparationRounds = 0;
+    capacityViolated = false;
+
+    try
+    {
+        std::vector<IloConversion> relaxations;
+        relaxIntegrality(relaxations);
+        masterCplex.setParam(IloCplex::Param::TimeLimit, paramReg->maxRunTime);
+        while (elapsed() < paramReg->maxRunTime && masterCplex.solve() && addViolatedCapacityRows() > 0)
+            numSeparationRounds++;
+        restoreIntegrality(relaxations);
+
+        // the last integer solution is always checked; out of time, a violated one is flagged
+        runSolver();
+        numSeparationRounds++;
+        while (hasSolution() && addViolatedCapacityRows() > 0)
+        {
+            if (elapsed() >= paramReg->maxRunTime)
+            {
+                capacityViolated = true;
+                break;
+            }
+            runSolver();
+            numSeparationRounds++;
+        }
+
+        if (paramReg->printAlgProcess)
+            cout << "Lazy rows: " << numCapacityRows << " of " << modelLegs.size()
+                << " capacity rows in " << numSeparationRounds << " rounds, " << elapsed() << "s" << endl;
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
+/* Benders decomposition: the master holds the fleet flows and a revenue variable per passenger
+ * component, bounded by what the component earns with all its demand carried. Every round the
+ * seats of the master solution go to PassengerAllocation, and each component whose revenue
+ * variable exceeds its LP revenue gets the optimality cut
+ *     theta_c <= revenue_c + sum_{l in c} pi_l (seats_l(y) - seats_l)
+ * from the capacity duals pi. Passengers are continuous in the subproblems. As with the lazy
+ * rows, the LP relaxation is cut first, then the integer solutions, until no cut is violated or
+ * the master bound is within bendersGapTol of the profit of the master's fleet assignment. */
+void TS_Model::solveBenders()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const auto& aircrafts = DataRegistry::instance()->aircrafts;
+    const int numAircraft = getNumTypeAircrafts();
+    const int numLegs = static_cast<int>(DataRegistry::instance()->schLegs.size());
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    numBendersRounds = 0;
+    numBendersCuts = 0;
+    char buf[100];
+
+    try
+    {
+        // demand may have changed since the last solve, so the components are set up anew
+        PassengerAllocation allocation(modelLegs, modelProducts, paramReg->bendersWorkers);
+        const int numComponents = allocation.getNumComponents();
+        if (!varRevenue.getImpl())
+        {
+            varRevenue = IloNumVarArray(env);
+            for (int c = 0; c < numComponents; c++)
+            {
+                std::sprintf(buf, "Revenue(%d)", c);
+                varRevenue.add(IloNumVar(env, 0, +IloInfinity, IloNumVar::Float, buf));
+                masterObj.setLinearCoef(varRevenue[c], 1);
+            }
+            masterModel.add(varRevenue);
+        }
+        for (int c = 0; c < numComponents; c++)
+            varRevenue[c].setUB(allocation.getMaxRevenue(c));
+        // the cuts of an earlier solve hold for its demand only
+        if (BendersCuts.getImpl())
+        {
+            masterModel.remove(BendersCuts);
+            BendersCuts.endElements();
+        }
+        BendersCuts = IloRangeArray(env);
+
+        // flight arcs of each leg, retimed copies included
+        std::vector<std::vector<int> > legArcs(numLegs);
+        for (int i = 0; i < static_cast<int>(allFlightArcs.size()); i++)
+            legArcs[getIndex(allFlightArcs[i]->getLeg())].push_back(i);
+
+        // subproblems for the seats of the current master solution, and the profit of its fleets
+        std::vector<double> seats(numLegs);
+        std::vector<double> theta(numComponents);
+        auto evaluate = [&]() -> bool {
+            IloNumArray vals(env);
+            seats.assign(numLegs, 0.0);
+            for (int l : modelLegs)
+                for (int i : legArcs[l])
+                {
+                    masterCplex.getValues(vals, varAssignFlightArcs[i]);
+                    for (int k = 0; k < numAircraft; k++)
+                        seats[l] += vals[k] * aircrafts[k]->getCapacity();
+                }
+            masterCplex.getValues(vals, varRevenue);
+            for (int c = 0; c < numComponents; c++)
+                theta[c] = vals[c];
+            vals.end();
+            if (!allocation.solve(seats))
+                return false;
+            numBendersRounds++;
+
+            const double master = masterCplex.getObjValue();
+            bendersBound = masterCplex.isMIP() ? masterCplex.getBestObjValue() : master;
+            bendersProfit = master;
+            for (int c = 0; c < numComponents; c++)
+                bendersProfit += allocation.getRevenue(c) - theta[c];
+            return true;
+        };
+        auto converged = [&]() -> bool {
+            return bendersBound - bendersProfit <= paramReg->bendersGapTol * std::max(1.0, std::fabs(bendersBound));
+        };
+        // cuts for the components whose revenue the master overestimates, returns how many
+        auto addCuts = [&]() -> int {
+            int added = 0;
+            for (int c = 0; c < numComponents; c++)
+            {
+                const double rev = allocation.getRevenue(c);
+                if (theta[c] <= rev + 1.0e-6 * std::max(1.0, std::fabs(rev)))
+                    continue;
+                IloExpr cut(env);
+                cut += varRevenue[c];
+                double rhs = rev;
+                for (int l : allocation.getLegs(c))
+                {
+                    const double pi = allocation.getSeatValue(l);
+                    if (pi == 0)
+                        continue;
+                    rhs -= pi * seats[l];
+                    for (int i : legArcs[l])
+                        for (int k = 0; k < numAircraft; k++)
+                            cut -= varAssignFlightArcs[i][k] * (pi * aircrafts[k]->getCapacity());
+                }
+                std::sprintf(buf, "BendersCut(%d_%d)", c, numBendersRounds);
+                BendersCuts.add(IloAdd(masterModel, IloRange(env, -IloInfinity, cut, rhs, buf)));
+                cut.end();
+                added++;
+            }
+            numBendersCuts += added;
+            if (paramReg->printAlgProcess)
+                cout << "Benders round " << numBendersRounds << ": bound " << bendersBound << ", profit " << bendersProfit
+                    << ", " << added << " cuts" << endl;
+            return added;
+        };
+        auto proceed = [&]() -> bool {
+            return numBendersRounds < paramReg->bendersMaxRounds && elapsed() < paramReg->maxRunTime;
+        };
+
+        std::vector<IloConversion> relaxations;
+        relaxIntegrality(relaxations);
+        masterCplex.setParam(IloCplex::Param::TimeLimit, paramReg->maxRunTime);
+        while (proceed() && masterCplex.solve() && evaluate() && addCuts() > 0)
+            ;
+        restoreIntegrality(relaxations);
+
+        // a cut changes the model and drops its solution, so none is added once the search stops
+        do
+        {
+            runSolver();
+        } while (hasSolution() && evaluate() && !converged() && proceed() && addCuts() > 0);
+
+        if (paramReg->printAlgProcess)
+            cout << "Benders: " << numComponents << " passenger components, " << numBendersCuts << " cuts in "
+                << numBendersRounds << " rounds, " << elapsed() << "s" << endl;
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
 void TS_Model::solveModel()
 {
     masterCplex.extract(masterModel);
     masterCplex.setParam(IloCplex::RootAlg, IloCplex::Auto);
     masterCplex.setParam(IloCplex::Param::MIP::Tolerances::MIPGap, ParamRegistry::instance()->mpGapTol);
     masterCplex.setParam(IloCplex::Param::TimeLimit,ParamRegistry::instance()->maxIpRunTime);
+    applySolverGuidance();
     if (ParamRegistry::instance()->writeLpFiles)
     {
         std::string filename = output_directory + "Direct.lp";
@@ -393,26 +1808,275 @@ void TS_Model::solveModel()
     masterCplex.solve();
 }
 
+/* Heuristic for instances too large for branch-and-bound: solve the LP relaxation once, then
+ * repeatedly fix the most integral flight-arc assignments and re-solve the LP (dual simplex warm
+ * starts from the previous basis). Whatever is still free when the dive ends is left to a short
+ * MIP over the fixed model; the root LP, the dive and that MIP all share maxDivingTime. */
+void TS_Model::solveLpDiving()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const int numAircraft = getNumTypeAircrafts();
+    const int numFlightArcs = static_cast<int>(allFlightArcs.size());
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto remaining = [&]() -> double {
+        return paramReg->maxDivingTime - elapsed();
+    };
+    lpBoundValid = false;
+
+    try
+    {
+        // relax the integrality of every variable
+        std::vector<IloConversion> relaxations;
+        relaxIntegrality(relaxations);
+
+        // the root LP gets at most half of the budget, the dive and the MIP the rest
+        masterCplex.extract(masterModel);
+        masterCplex.setParam(IloCplex::RootAlg, IloCplex::Dual);
+        masterCplex.setParam(IloCplex::Param::TimeLimit, 0.5 * paramReg->maxDivingTime);
+        const bool rootSolved = masterCplex.solve();
+        // only an optimal LP bounds the MIP; a time-limited one is just some LP solution
+        if (masterCplex.getStatus() == IloAlgorithm::Optimal)
+        {
+            lpBound = masterCplex.getObjValue();
+            lpBoundValid = true;
+        }
+        if (!rootSolved)
+            cerr << "LP relaxation could not be solved: " << masterCplex.getStatus() << endl;
+
+        // fixed[i * numAircraft + k] is set once arc i / fleet k has been rounded
+        std::vector<char> fixed(static_cast<size_t>(numFlightArcs) * numAircraft, 0);
+        IloNumArray vals(env);
+        int numRounds = 0;
+        int numRepairs = 0;
+
+        while (rootSolved && remaining() > 0)
+        {
+            // (distance to nearest integer, index) of the free fractional entries
+            std::vector<std::pair<double, int> > candidates;
+            std::vector<int> integral;
+            for (int i = 0; i < numFlightArcs; i++)
+            {
+                masterCplex.getValues(vals, varAssignFlightArcs[i]);
+                for (int k = 0; k < numAircraft; k++)
+                {
+                    const int idx = i * numAircraft + k;
+                    if (fixed[idx])
+                        continue;
+                    const double dist = std::fabs(vals[k] - std::floor(vals[k] + 0.5));
+                    if (dist > paramReg->divingIntTol)
+                        candidates.emplace_back(dist, idx);
+                    else if (vals[k] > 0.5)
+                        integral.push_back(idx);
+                }
+            }
+            if (candidates.empty())
+                break;
+
+            // positive integral entries are fixed together with the most integral fractional ones
+            const int batch = std::min(paramReg->divingBatchSize, static_cast<int>(candidates.size()));
+            std::partial_sort(candidates.begin(), candidates.begin() + batch, candidates.end());
+
+            std::vector<std::pair<int, double> > roundFixes;
+            for (int idx : integral)
+                roundFixes.emplace_back(idx, std::floor(masterCplex.getValue(varAssignFlightArcs[idx / numAircraft][idx % numAircraft]) + 0.5));
+            for (int c = 0; c < batch; c++)
+            {
+                const int idx = candidates[c].second;
+                roundFixes.emplace_back(idx, std::floor(masterCplex.getValue(varAssignFlightArcs[idx / numAircraft][idx % numAircraft]) + 0.5));
+            }
+
+            for (const auto& fix : roundFixes)
+            {
+                varAssignFlightArcs[fix.first / numAircraft][fix.first % numAircraft].setBounds(fix.second, fix.second);
+                fixed[fix.first] = 1;
+            }
+            numRounds++;
+
+            masterCplex.setParam(IloCplex::Param::TimeLimit, remaining());
+            if (masterCplex.solve())
+                continue;
+            // out of time rather than infeasible: the MIP takes over from these fixes
+            if (masterCplex.getCplexStatus() != IloCplex::Infeasible || remaining() <= 0)
+                break;
+
+            // repair: the rounding broke flow balance, so release this round's fractional fixes
+            // and push the most integral entry to its other neighbouring integer instead
+            numRepairs++;
+            for (int c = 0; c < batch; c++)
+            {
+                const int idx = candidates[c].second;
+                varAssignFlightArcs[idx / numAircraft][idx % numAircraft].setBounds(0, IloInfinity);
+                fixed[idx] = 0;
+            }
+            const auto& best = roundFixes[integral.size()];
+            const double flipped = best.second > 0 ? best.second - 1 : best.second + 1;
+            auto& bestVar = varAssignFlightArcs[best.first / numAircraft][best.first % numAircraft];
+            bestVar.setBounds(flipped, flipped);
+            fixed[best.first] = 1;
+            masterCplex.setParam(IloCplex::Param::TimeLimit, remaining());
+            if (masterCplex.solve())
+                continue;
+
+            // still infeasible (or out of time): leave the entry free and hand the rest to the MIP
+            bestVar.setBounds(0, IloInfinity);
+            fixed[best.first] = 0;
+            break;
+        }
+        vals.end();
+
+        // restore integrality and close the remaining (mostly fixed) model if time is left
+        restoreIntegrality(relaxations);
+
+        masterCplex.extract(masterModel);
+        if (remaining() > 0)
+        {
+            masterCplex.setParam(IloCplex::Param::MIP::Tolerances::MIPGap, paramReg->mpGapTol);
+            masterCplex.setParam(IloCplex::Param::TimeLimit, remaining());
+            masterCplex.solve();
+        }
+        else
+            cerr << "LP diving: the budget ran out before the closing MIP" << endl;
+
+        if (paramReg->printAlgProcess)
+        {
+            cout << "LP diving: " << numRounds << " rounds, " << numRepairs << " repairs, "
+                << elapsed() << "s" << endl;
+            if (lpBoundValid)
+                cout << "LP bound:\t" << lpBound << endl;
+            else
+                cout << "LP bound:\tnone, the root LP stopped early" << endl;
+            if (hasSolution() && lpBoundValid && lpBound != 0)
+                cout << "Gap to LP bound:\t" << (lpBound - masterCplex.getObjValue()) / std::fabs(lpBound) << endl;
+        }
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
+/* Fleet swaps and chain exchanges on the MIP solution (see LocalSearch); an improved solution goes
+ * back to CPLEX as a MIP start and a short re-solve takes it as the incumbent. */
+void TS_Model::improveByLocalSearch()
+{
+    const auto paramReg = ParamRegistry::instance();
+    const int numAircraft = getNumTypeAircrafts();
+    const int numFlightArcs = static_cast<int>(allFlightArcs.size());
+    const int numGroundArcs = static_cast<int>(allGroundArcs.size());
+
+    try
+    {
+        if (!hasSolution() || !masterCplex.isMIP())
+            return;
+        const double before = masterCplex.getObjValue();
+
+        LocalSearch::Solution start;
+        IloNumArray vals(env);
+        start.fleetOf.assign(numFlightArcs, -1);
+        for (int i = 0; i < numFlightArcs; i++)
+        {
+            masterCplex.getValues(vals, varAssignFlightArcs[i]);
+            for (int k = 0; k < numAircraft; k++)
+                if (vals[k] > 0.5)
+                    start.fleetOf[i] = k;
+        }
+        start.ground.assign(static_cast<size_t>(numGroundArcs) * numAircraft, 0.0);
+        for (int g = 0; g < numGroundArcs; g++)
+        {
+            masterCplex.getValues(vals, varAssignGroundArcs[g]);
+            for (int k = 0; k < numAircraft; k++)
+                start.ground[g * numAircraft + k] = std::floor(vals[k] + 0.5);
+        }
+        masterCplex.getValues(vals, varSatisfiedDemand);
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+            start.satisfied.push_back(std::floor(vals[i] + 0.5));
+        vals.end();
+
+        LocalSearch search(*this, start, paramReg->maxChainLength);
+        const double gain = search.run(paramReg->localSearchTime, 0);
+        if (paramReg->printAlgProcess)
+            cout << "Local search: " << search.getNumMoves() << " moves, +" << gain << endl;
+        if (search.getNumMoves() == 0)
+            return;
+        double profit = 0;
+        if (!search.checkSolution(profit))
+        {
+            cerr << "Local search: the improved flows do not balance, solution not used" << endl;
+            return;
+        }
+        if (paramReg->printAlgProcess)
+            cout << "Local search solution: flying cost and fares " << profit << endl;
+
+        const auto& sol = search.getSolution();
+        IloNumVarArray startVars(env);
+        IloNumArray startVals(env);
+        for (int i = 0; i < numFlightArcs; i++)
+            for (int k = 0; k < numAircraft; k++)
+            {
+                startVars.add(varAssignFlightArcs[i][k]);
+                startVals.add(sol.fleetOf[i] == k ? 1.0 : 0.0);
+            }
+        for (int g = 0; g < numGroundArcs; g++)
+            for (int k = 0; k < numAircraft; k++)
+            {
+                startVars.add(varAssignGroundArcs[g][k]);
+                startVals.add(sol.ground[g * numAircraft + k]);
+            }
+        for (int i = 0; i < static_cast<int>(modelProducts.size()); i++)
+        {
+            startVars.add(varSatisfiedDemand[i]);
+            startVals.add(sol.satisfied[i]);
+        }
+        masterCplex.addMIPStart(startVars, startVals, IloCplex::MIPStartCheckFeas);
+        startVars.end();
+        startVals.end();
+
+        masterCplex.setParam(IloCplex::Param::TimeLimit, std::max(1.0, paramReg->localSearchMipTime));
+        masterCplex.solve();
+        if (paramReg->printAlgProcess && hasSolution())
+            cout << "Objective after local search: " << masterCplex.getObjValue() << " (was " << before << ")" << endl;
+    }
+    catch (const IloException& e)
+    {
+        cerr << "Exception caught: " << e << endl;
+    }
+    catch (...)
+    {
+        cerr << "Unknown exception caught!" << endl;
+    }
+}
+
 void TS_Model::updateSolution()
 {
-    const auto &legs = DataRegistry::instance()->schLegs;
     try
     {
-        if (masterCplex.getStatus() == IloAlgorithm::Infeasible || masterCplex.getStatus() == IloAlgorithm::Unbounded)
+        // leg index -> fleet index
+        assignment.clear();
+        retimedDepartures.clear();
+        // also when a time-boxed mode ran out of budget before its MIP found anything
+        if (!hasSolution())
         {
             return;
         }
 
-        for (const auto& ac : DataRegistry::instance()->aircrafts) {
-            int j = 0;
-            for (const auto pArc : allFlightArcs) {
-                int i = 0;
+        const int numAircraft = getNumTypeAircrafts();
+        int i = 0;
+        for (const auto pArc : allFlightArcs) {
+            for (int j = 0; j < numAircraft; j++) {
                 if (masterCplex.getValue(varAssignFlightArcs[i][j]) > 0.99) {
-                    assignment.emplace(legs[i]->getFltID(), j);   
+                    assignment.emplace(getIndex(pArc->getLeg()), j);
+                    if (i >= numBaseFlightArcs)
+                        retimedDepartures[getIndex(pArc->getLeg())] = pArc->getStartTime();
                 }
-                i++;
             }
-            j++;
+            i++;
         }
         
     }
@@ -432,15 +2096,55 @@ void TS_Model::writeResults()
     std::ofstream output;
     output.open(filename.c_str());
 
-    output << "Objective:\t" << masterCplex.getObjValue() << std::endl;
+    if (hasSolution())
+        output << "Objective:\t" << masterCplex.getObjValue() << std::endl;
+    else
+        output << "Objective:\tnone" << std::endl;
     output << "Total CPU time:\t" << cpuTime << std::endl;
+    if (ParamRegistry::instance()->lazyCapacityRows)
+    {
+        output << "Capacity rows:\t" << numCapacityRows << " / " << modelLegs.size() << std::endl;
+        output << "Demand rows:\t0 / " << modelProducts.size() << " (bounds)" << std::endl;
+        output << "Separation rounds:\t" << numSeparationRounds << std::endl;
+        if (capacityViolated)
+            output << "Capacity feasible:\tno, time ran out with capacity rows violated" << std::endl;
+    }
+    if (ParamRegistry::instance()->useBenders)
+    {
+        output << "Benders rounds:\t" << numBendersRounds << std::endl;
+        output << "Benders cuts:\t" << numBendersCuts << std::endl;
+        output << "Benders bound:\t" << bendersBound << std::endl;
+        output << "Benders profit:\t" << bendersProfit << std::endl;
+    }
+    if (ParamRegistry::instance()->useLpDiving)
+    {
+        if (lpBoundValid)
+            output << "LP bound:\t" << lpBound << std::endl;
+        else
+            output << "LP bound:\tnone" << std::endl;
+        // relative to the bound, so only with an incumbent and a nonzero bound
+        if (hasSolution() && lpBoundValid && lpBound != 0)
+            output << "Gap to LP bound:\t" << (lpBound - masterCplex.getObjValue()) / std::fabs(lpBound) << std::endl;
+    }
+    if (ParamRegistry::instance()->logProgress)
+    {
+        const auto& targets = ParamRegistry::instance()->progressGapTargets;
+        const auto times = progressLog.timeToGap(targets);
+        for (size_t i = 0; i < targets.size(); i++)
+            if (times[i] >= 0)
+                output << "Time to gap " << targets[i] << ":\t" << times[i] << std::endl;
+    }
     output << "================== Aircraft Assignment ==================" << std::endl;
     const auto& aircrafts = DataRegistry::instance()->aircrafts;
     const auto& legs = DataRegistry::instance()->schLegs;
     for (auto& it : assignment)
     {
-        output << legs[it.first]->getFlightNum();
-        output << aircrafts[it.second]->getTail() << std::endl;
+        output << legs[it.first]->getFlightNum() << "\t";
+        output << aircrafts[it.second]->getTail();
+        auto itRetimed = retimedDepartures.find(it.first);
+        if (itRetimed != retimedDepartures.end())
+            output << "\t" << itRetimed->second;
+        output << std::endl;
    }
 
 
@@ -461,6 +2165,7 @@ void TS_Model::deleteModel()
 
     varAssignFlightArcs.end();
     varAssignGroundArcs.end();
+    guidanceFixes.clear();
 
     FlightCover.end();
 
@@ -12,6 +12,7 @@
 #include <map>
 #include <ctime>
 #include <memory>
+#include <stdexcept>
 #include <ilcplex/ilocplex.h>
 
 #include "Flight.h"
@@ -19,6 +20,8 @@
 #include "Product.h"
 #include "DataManager.h"
 #include "TS_Network.h"
+#include "ModelCache.h"
+#include "ProgressLog.h"
 
 typedef IloArray<IloNumVarArray> IloNumVarArray2;
 typedef IloArray<IloIntVarArray> IloIntVarArray2;
@@ -34,16 +37,56 @@ private:
 	std::vector<std::shared_ptr<TS_Arc> > allArcs;
 
 	std::map<int, std::vector<TS_Node*> > stationNodesMap;
+	std::map<std::pair<int, std::string>, TS_Node* > nodeIndex;
 	std::vector<TS_Arc* > allFlightArcs;
 	std::vector<TS_Arc* > allGroundArcs;
 
+	// fleets sharing a minimum turn time form a turn class. Class 0 arrivals are the flight arcs'
+	// own head nodes; the other classes overlay their shifted heads on the same station timeline,
+	// stored arc-major as [arc * (numClasses - 1) + class - 1] so that new arcs append.
+	std::vector<int> turnClassTimes;
+	std::vector<int> fleetTurnClass;
+	std::vector<TS_Node* > shiftedHeads;
+
+	// legs and products in the model, by index in DataRegistry; all of them unless scoped
+	bool scoped;
+	std::vector<int> modelLegs;
+	std::vector<int> modelProducts;
+	// product index -> position in varSatisfiedDemand / ProductDemand, -1 outside the scope
+	std::vector<int> productSlot;
+
 	std::vector<Flight* > unassignedFlights;
 	std::map<unsigned, unsigned > assignment;
+	// leg index -> departure time, for legs flown on a retimed copy
+	std::map<unsigned, std::string > retimedDepartures;
+	// leg index -> fleet index the leg is held on, see fixLeg
+	std::map<unsigned, unsigned > legFixings;
+	// (ground arc, fleet) held at zero by applySolverGuidance for the current solve
+	std::vector<std::pair<int, int> > guidanceFixes;
+	int numBaseFlightArcs;
+	int numCapacityRows;
+	int numSeparationRounds;
+	// the final lazy-row solution overloads legs whose capacity rows were added too late
+	bool capacityViolated;
+	int numBendersRounds;
+	int numBendersCuts;
+	double bendersBound;
+	double bendersProfit;
 
 	std::string input_directory;
 	std::string output_directory;
 
 	double cpuTime;
+	double lpBound;
+	// lpBound is the root LP optimum; a root LP stopped by its time limit leaves no bound
+	bool lpBoundValid;
+	// set by checkFleetSize when the fleets cannot cover the network
+	bool fleetShortage;
+	int minFleetSize;
+	int numUnbalancedStations;
+	// aircraft per fleet in the FleetNum rows, see setFleetSize
+	std::vector<int> fleetSizes;
+	ProgressLog progressLog;
 
 	IloEnv env;
 	IloCplex masterCplex;
@@ -58,6 +101,11 @@ private:
 	IloRangeArray ProductDemand;
 	IloRangeArray FleetNum;
 	IloRangeArray2 NonDirectFlights;
+	IloNumVarArray varFleetUsage;
+	IloRangeArray FleetUsage;
+	// Benders master: revenue per passenger component and the optimality cuts on it
+	IloNumVarArray varRevenue;
+	IloRangeArray BendersCuts;
 
 public:
 	explicit TS_Model(const std::string& directory);
@@ -65,11 +113,58 @@ public:
 	virtual void optimize();
 	virtual void buildNetwork();
 
-	void buildFormulation();
+	// optimize() is prepare(), solve() and the reports; a resident model calls solve() again
+	// after changing demand or fixings
+	void prepare();
+	void buildModel();
+	void solve();
+	void setScope(const std::vector<int>& legs, const std::vector<int>& products);
+	// writes the model as MPS from the network alone, without building it in Concert
+	void exportMps(const std::string& filename);
+	void addFleetUsage();
+	void setFleetPrice(int k, double price);
+	double getFleetUsage(int k) const;
+	void setProductDemand(int p, double demand);
+	void setFleetSize(int k, int n);
+	void addSolutionAsStart();
+	void fixLeg(int l, int k);
+	void unfixLeg(int l);
+	void applyLegFixings();
+
+	bool checkFleetSize();
+	void buildNetworkFormulation();
+	void buildProductFormulation();
 	void initObjective();
 	void initVariables();
 	void initConstraints();
+	void initProductSlots();
+	void initProductVariables();
+	void initProductObjective();
+	void initProductConstraints();
+	void linkArcsToNodes();
+	// the formulation from / into ParamRegistry::modelCacheDir, see ModelCache
+	bool loadCachedModel(const ModelCache& cache);
+	void saveCachedModel(const ModelCache& cache);
+	void generateRetimedCopies();
+	TS_Node* insertNode(const std::string& _t, Station* _s, std::vector<IloConversion>& relaxations);
+	TS_Node* getTimelineNode(const std::string& _t, Station* _s);
+	// node times: departures round down, ready times after an arrival round up to the time bucket
+	std::string depNodeTime(int minutes) const;
+	std::string readyNodeTime(int minutes) const;
+	void reportDiscretization();
+	void addFlightCopy(int baseArc, int shift, std::vector<IloConversion>& relaxations);
+	void runSolver();
+	void applySolverGuidance();
+	void relaxIntegrality(std::vector<IloConversion>& relaxations);
+	void restoreIntegrality(std::vector<IloConversion>& relaxations);
+	bool hasSolution() const;
+	void addCapacityRow(int l, const std::vector<int>& arcs);
+	int addViolatedCapacityRows();
+	void solveWithLazyRows();
+	void solveBenders();
 	void solveModel();
+	void solveLpDiving();
+	void improveByLocalSearch();
 	void updateSolution();
 	void writeResults();
 	void deleteModel();
@@ -79,19 +174,30 @@ public:
 	void setInputDirectory(const std::string& _dir) { input_directory = _dir; }
 	void setOutputDirectory(const std::string& dir) { output_directory = dir; }
 	std::string getInputDirectory() const { return input_directory; }
+	const std::map<unsigned, unsigned>& getAssignment() const { return assignment; }
+	const std::map<unsigned, unsigned>& getLegFixings() const { return legFixings; }
+	const std::vector<TS_Arc* >& getFlightArcs() const { return allFlightArcs; }
+	const std::vector<TS_Arc* >& getGroundArcs() const { return allGroundArcs; }
+	const std::map<int, std::vector<TS_Node*> >& getStationNodes() const { return stationNodesMap; }
+	int getNumNodes() const { return static_cast<int>(allNodes.size()); }
+	int getNumBaseFlightArcs() const { return numBaseFlightArcs; }
+	bool isScoped() const { return scoped; }
+	const std::vector<int>& getModelProducts() const { return modelProducts; }
+	const std::vector<int>& getProductSlot() const { return productSlot; }
+	const std::map<unsigned, std::string>& getRetimedDepartures() const { return retimedDepartures; }
+	double getCpuTime() const { return cpuTime; }
+	bool hasFleetShortage() const { return fleetShortage; }
+	int getMinFleetSize() const { return minFleetSize; }
+	const ProgressLog& getProgressLog() const { return progressLog; }
+	IloCplex& getCplex() { return masterCplex; }
 
 	TS_Node* addNode(std::string _t, Station* _s) {
-		const auto it = std::find_if(allNodes.begin(), allNodes.end(), [_t, _s](const shared_ptr<TS_Node>& n)->bool {
-			return (n->getTime() == _t) && (n->getStation() == _s);
-			});
-		if (it == allNodes.end()) {
-			auto pNode = std::make_shared<TS_Node>(_t, _s);
-			allNodes.push_back(pNode);
-			return pNode.get();
-		}
-		else {
-			return it->get();
+		auto& pNode = nodeIndex[std::make_pair(_s->getID(), _t)];
+		if (!pNode) {
+			allNodes.push_back(std::make_shared<TS_Node>(_t, _s));
+			pNode = allNodes.back().get();
 		}
+		return pNode;
 	}
 
 	void addArc(TS_Node* _depNode, TS_Node* _arrNode, Leg* _leg) {
@@ -100,28 +206,48 @@ public:
 	}
 
 	TS_Node* getNode(std::string _t, Station* _s) {
-		const auto it = std::find_if(allNodes.begin(), allNodes.end(), [_t, _s](const shared_ptr<TS_Node>& n)->bool {
-			return (n->getTime() == _t) && (n->getStation() == _s);
-			});
-		return it->get();
+		auto it = nodeIndex.find(std::make_pair(_s->getID(), _t));
+		return it == nodeIndex.end() ? nullptr : it->second;
+	}
+
+	// an arc holds its aircraft over [from, to), over midnight when it ends at or before its start,
+	// so at any time every aircraft in use is on exactly one arc
+	static bool crossesTime(const std::string& from, const std::string& to, const std::string& t) {
+		return from < to ? (from <= t && t < to) : (t >= from || t < to);
+	}
+
+	// the FleetNum rows count the aircraft on the arcs over ParamRegistry::countLine
+	static bool crossesCountLine(const std::string& from, const std::string& to) {
+		return crossesTime(from, to, ParamRegistry::instance()->countLine);
+	}
+
+	// arrival node of flight arc `arc` when flown by fleet `k`
+	TS_Node* getArcHead(int arc, int k) const {
+		const int c = fleetTurnClass[k];
+		if (c == 0)
+			return allFlightArcs[arc]->getHeadNode();
+		return getShiftedHead(arc, c);
+	}
+
+	TS_Node* getShiftedHead(int arc, int turnClass) const {
+		return shiftedHeads[arc * (turnClassTimes.size() - 1) + turnClass - 1];
 	}
 
+	// aircraft IDs are their 1-based position in the registry
 	static int getIndex(const Aircraft* a) {
 		const auto& aircrafts = DataRegistry::instance()->aircrafts;
-		auto it = std::find_if(aircrafts.begin(), aircrafts.end(), [a](const std::shared_ptr<Aircraft>& aircraft)->bool {
-			return a->getID() == aircraft->getID();
-			});
-		if (it == aircrafts.end()) exit(EXIT_FAILURE);
-		return static_cast<int>(it - aircrafts.begin());
+		const int idx = static_cast<int>(a->getID()) - 1;
+		if (idx < 0 || idx >= static_cast<int>(aircrafts.size()) || aircrafts[idx] != a)
+			throw std::out_of_range("aircraft " + a->getTail() + " is not registered");
+		return idx;
 	}
 
 	static int getIndex(const Leg* l) {
 		const auto& schLegs = DataRegistry::instance()->schLegs;
-		auto it = std::find_if(schLegs.begin(), schLegs.end(), [l](const std::shared_ptr<Leg>& _l)->bool {
-			return _l->getID() == l->getID();
-			});
-		if (it == schLegs.end()) exit(EXIT_FAILURE);
-		return int(it - schLegs.begin());
+		const int idx = l->getIndex();
+		if (idx < 0 || idx >= static_cast<int>(schLegs.size()) || schLegs[idx] != l)
+			throw std::out_of_range("leg " + std::to_string(l->getID()) + " is not registered");
+		return idx;
 	}
 
 
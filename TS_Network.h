@@ -25,6 +25,8 @@ public:
 	std::vector<int > leavingFlightArcs;
 	std::vector<int > enteringGroundArcs;
 	std::vector<int > leavingGroundArcs;
+	// (turn class, flight arc) for arrivals shifted by a fleet's minimum turn time
+	std::vector<std::pair<int, int> > enteringShiftedArcs;
 
 	std::vector<TS_Arc* > leavingArcs;
 	std::vector<TS_Arc* > enteringArcs;
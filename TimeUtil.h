@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Network times are "HHMM" strings within one day; these convert to and from minutes after midnight.
+inline int toMinutes(const std::string& hhmm)
+{
+	const int v = std::stoi(hhmm);
+	return (v / 100) * 60 + v % 100;
+}
+
+inline std::string toTimeString(int minutes)
+{
+	minutes = ((minutes % 1440) + 1440) % 1440;
+	char buf[8];
+	std::snprintf(buf, sizeof(buf), "%02d%02d", minutes / 60, minutes % 60);
+	return buf;
+}
+
+// Boundaries of `bucket`-minute intervals: the one at or before `minutes`, and the one at or after.
+inline int bucketDown(int minutes, int bucket)
+{
+	return bucket > 1 ? minutes - ((minutes % bucket) + bucket) % bucket : minutes;
+}
+
+inline int bucketUp(int minutes, int bucket)
+{
+	return bucket > 1 ? bucketDown(minutes + bucket - 1, bucket) : minutes;
+}
@@ -1,12 +1,56 @@
 #include "DataManager.h"
 #include <iostream>
+#include <string>
 #include "TS_Model.h"
+#include "OptimizationService.h"
+#include "FleetSweep.h"
 
 
-int main()
+int main(int argc, char* argv[])
 {
-	auto data = DataRegistry::instance();
-	data->readInputDataFile("C:/Users/yuyl_Allen/Desktop/");
+	// the model reads its input directory itself, see TS_Model::prepare
 	TS_Model tsModel("C:/Users/yuyl_Allen/Desktop/");
+
+	// --serve: keep the model resident and answer JSON requests on stdin
+	if (argc > 1 && std::string(argv[1]) == "--serve")
+	{
+		OptimizationService service(tsModel);
+		std::cout << service.prepare() << std::endl;
+		service.run(std::cin, std::cout);
+		return 0;
+	}
+	// --export-mps FILE: write the model for another solver, without building it in CPLEX
+	if (argc > 2 && std::string(argv[1]) == "--export-mps")
+	{
+		tsModel.exportMps(argv[2]);
+		return 0;
+	}
+	// --sweep: profit against the size of each fleet, see FleetSweep
+	if (argc > 1 && std::string(argv[1]) == "--sweep")
+	{
+		FleetSweep sweep(tsModel.getInputDirectory(), tsModel.getInputDirectory() + "out/");
+		sweep.run();
+		sweep.writeTable(tsModel.getInputDirectory() + "out/sweep.csv");
+		return 0;
+	}
+	// --guidance-benchmark: the same solve without and with SolverGuidance; time to gap of both
+	// runs is appended to out/guidance.csv, one pair of rows per input directory
+	if (argc > 1 && std::string(argv[1]) == "--guidance-benchmark")
+	{
+		const auto paramReg = ParamRegistry::instance();
+		const std::string output = tsModel.getInputDirectory() + "out/";
+		paramReg->logProgress = true;
+		for (const bool guided : { false, true })
+		{
+			paramReg->solverGuidance = guided;
+			TS_Model model(tsModel.getInputDirectory());
+			model.setOutputDirectory(output + (guided ? "guided_" : "unguided_"));
+			model.prepare();
+			model.solve();
+			model.getProgressLog().appendSummary(output + "guidance.csv",
+				model.getInputDirectory() + (guided ? " guided" : " unguided"), paramReg->progressGapTargets);
+		}
+		return 0;
+	}
 	tsModel.optimize();
 }
\ No newline at end of file